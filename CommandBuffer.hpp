@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "Component.hpp"
+
+namespace kengine {
+	class Entity;
+
+	// Records structural changes to be played back by EntityManager::playbackCommands. Obtained through EntityManager::getCommandBuffer,
+	// which returns a different buffer for each thread, so recording doesn't contend on the EntityManager's locks. `id` parameters are `Entity::ID`s
+	class CommandBuffer {
+	public:
+		template<typename T>
+		void attach(size_t id) {
+			push({ Command::Type::Attach, id, Component<T>::id(), nullptr });
+		}
+
+		template<typename T>
+		void attach(size_t id, T && comp) {
+			using Comp = std::decay_t<T>;
+			static_assert(!detail::is_shared<Comp>(), "Assigning would modify the value shared by the whole archetype, use Entity::setShared instead");
+			push({ Command::Type::Attach, id, Component<Comp>::id(), [comp = FWD(comp)](detail::GlobalCompMap & components, size_t id) mutable { Component<Comp>::get(components, id) = std::move(comp); } });
+		}
+
+		template<typename T>
+		void detach(size_t id) {
+			push({ Command::Type::Detach, id, Component<T>::id(), nullptr });
+		}
+
+		void removeEntity(size_t id) {
+			push({ Command::Type::Remove, id, detail::INVALID, nullptr });
+		}
+
+		template<typename Func> // Func: void(Entity &)
+		void createEntity(Func && postCreate) {
+			{
+				detail::WriteLock l(_mutex);
+				_creations.emplace_back(FWD(postCreate));
+			}
+			_hasCommands = true;
+		}
+
+	private:
+		friend class EntityManager;
+
+		struct Command {
+			enum class Type {
+				Attach,
+				Detach,
+				Remove
+			};
+
+			Type type;
+			size_t id; // Entity ID
+			size_t component;
+			std::function<void(detail::GlobalCompMap &, size_t)> assign; // Only set for attachments with a value. Given the playing EntityManager's storage
+		};
+
+		void push(Command && command) {
+			{
+				detail::WriteLock l(_mutex); // Only contended during playback
+				_commands.push_back(std::move(command));
+			}
+			_hasCommands = true;
+		}
+
+		void take(std::vector<Command> & commands, std::vector<std::function<void(Entity &)>> & creations) {
+			detail::WriteLock l(_mutex);
+			for (auto & command : _commands)
+				commands.push_back(std::move(command));
+			_commands.clear();
+			for (auto & creation : _creations)
+				creations.push_back(std::move(creation));
+			_creations.clear();
+			_hasCommands = false;
+		}
+
+	private:
+		std::vector<Command> _commands;
+		std::vector<std::function<void(Entity &)>> _creations;
+		std::atomic<bool> _hasCommands = false;
+		detail::Mutex _mutex;
+	};
+}
@@ -1,5 +1,28 @@
 #include "Component.hpp"
 
 namespace kengine::detail {
-	GlobalCompMap * components = nullptr;
-}
\ No newline at end of file
+	static ComponentRegistry & getDefaultRegistry() {
+		static ComponentRegistry ret; // Function-static, so that it is constructed on first use
+		return ret;
+	}
+
+	ComponentRegistry * registry = &getDefaultRegistry();
+	thread_local GlobalCompMap * currentComponents = nullptr;
+	std::atomic<GlobalCompMap *> defaultComponents = nullptr;
+
+	static std::mutex worldsMutex;
+	static std::vector<GlobalCompMap *> worlds; // Live EntityManagers, in order of creation. Protected by `worldsMutex`
+
+	void addWorld(GlobalCompMap * components) {
+		std::lock_guard l(worldsMutex);
+		worlds.push_back(components);
+		defaultComponents = components;
+	}
+
+	void removeWorld(GlobalCompMap * components) {
+		std::lock_guard l(worldsMutex);
+		worlds.erase(std::find(worlds.begin(), worlds.end(), components));
+		if (defaultComponents == components)
+			defaultComponents = worlds.empty() ? nullptr : worlds.back();
+	}
+}
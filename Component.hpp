@@ -4,15 +4,28 @@
 # define KENGINE_COMPONENT_CHUNK_SIZE 64
 #endif
 
+#ifndef KENGINE_COMPONENT_MAX_CHUNKS
+# define KENGINE_COMPONENT_MAX_CHUNKS 8192
+#endif
+
+#ifndef KENGINE_COMPONENT_COUNT
+# define KENGINE_COMPONENT_COUNT 64
+#endif
+
 #ifndef KENGINE_NDEBUG
 #include <iostream>
 #endif
 
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
 #include <shared_mutex>
 #include <fstream>
 #include <cstddef>
+#include <cstdint>
 #include <unordered_map>
 #include <memory>
 #include <vector>
@@ -24,77 +37,451 @@
 
 namespace kengine {
 	namespace detail {
+#ifdef KENGINE_SINGLE_THREADED
+		// All locks compile down to nothing. The EntityManager must then only ever be accessed from one thread, and have no worker threads
+		struct Mutex {
+			void lock() {}
+			void unlock() {}
+			bool try_lock() { return true; }
+			void lock_shared() {}
+			void unlock_shared() {}
+			bool try_lock_shared() { return true; }
+		};
+
+		struct ReadLock {
+			explicit ReadLock(Mutex &) {}
+			void lock() {}
+			void unlock() {}
+		};
+
+		struct WriteLock {
+			explicit WriteLock(Mutex &) {}
+			void lock() {}
+			void unlock() {}
+		};
+#else
 		using Mutex = std::shared_mutex;
 		using ReadLock = std::shared_lock<Mutex>;
 		using WriteLock = std::lock_guard<Mutex>;
+#endif
 	}
 
+	class EntityManager;
+
+	enum class ComponentStorage {
+		Chunks, // Sparse chunks indexed by Entity ID. References stay valid until the Component is detached
+		ArchetypeColumns, // Contiguous columns owned by each archetype. References are invalidated by any structural change to the archetype
+		Shared, // A single value per archetype, shared by all its Entities. Values are registered with EntityManager::addSharedValue
+		SparseSet // Packed array of the attached Components plus a paged index by Entity ID. References are invalidated by detaching the same type
+	};
+
+	// Specialize to change the way a Component type is stored
+	template<typename Comp>
+	struct component_storage {
+		static constexpr auto value = ComponentStorage::Chunks;
+	};
+
 	namespace detail {
 		static constexpr size_t INVALID = (size_t)-1;
 
-		struct MetadataBase {
+		template<typename Comp>
+		constexpr bool is_archetype_stored() {
+			return !std::is_empty<Comp>() && component_storage<Comp>::value == ComponentStorage::ArchetypeColumns;
+		}
+
+		template<typename Comp>
+		constexpr bool is_shared() {
+			return !std::is_empty<Comp>() && component_storage<Comp>::value == ComponentStorage::Shared;
+		}
+
+		template<typename Comp>
+		constexpr bool is_sparse_set() {
+			return !std::is_empty<Comp>() && component_storage<Comp>::value == ComponentStorage::SparseSet;
+		}
+
+		// Value-initialized array allocated from `memory`
+		template<typename T>
+		T * allocateArray(std::pmr::memory_resource & memory, size_t count) {
+			const auto ret = static_cast<T *>(memory.allocate(sizeof(T) * count, alignof(T)));
+			try {
+				std::uninitialized_value_construct_n(ret, count);
+			}
+			catch (...) {
+				memory.deallocate(ret, sizeof(T) * count, alignof(T));
+				throw;
+			}
+			return ret;
+		}
+
+		template<typename T>
+		void deallocateArray(std::pmr::memory_resource & memory, T * array, size_t count) {
+			std::destroy_n(array, count);
+			memory.deallocate(array, sizeof(T) * count, alignof(T));
+		}
+
+		// Type-erased archetype column, rows match the archetype's entity list
+		struct ColumnBase {
+			virtual ~ColumnBase() = default;
+			virtual void * at(size_t row) = 0;
+			virtual void emplaceDefault() = 0;
+			virtual void emplaceDefaults(size_t count) = 0;
+			virtual void moveRowTo(size_t row, ColumnBase & dest) = 0;
+			virtual void swapRemove(size_t row) = 0;
+			virtual void reorder(const std::vector<size_t> & order) = 0;
+			virtual void shrinkToFit() = 0;
+		};
+
+		template<typename Comp>
+		struct Column : ColumnBase {
+			std::pmr::vector<Comp> data;
+
+			explicit Column(std::pmr::memory_resource * memory) : data(memory) {}
+
+			void * at(size_t row) final { return &data[row]; }
+			void emplaceDefault() final { data.emplace_back(); }
+			void emplaceDefaults(size_t count) final { data.resize(data.size() + count); }
+			void moveRowTo(size_t row, ColumnBase & dest) final { static_cast<Column &>(dest).data.push_back(std::move(data[row])); }
+
+			void swapRemove(size_t row) final {
+				if (row != data.size() - 1)
+					data[row] = std::move(data.back());
+				data.pop_back();
+			}
+
+			void reorder(const std::vector<size_t> & order) final {
+				std::pmr::vector<Comp> tmp(data.get_allocator());
+				tmp.reserve(data.size());
+				for (const auto row : order)
+					tmp.push_back(std::move(data[row]));
+				data = std::move(tmp);
+			}
+
+			void shrinkToFit() final { data.shrink_to_fit(); }
+		};
+
+		struct GlobalCompMap;
+
+		// Process-wide information about a Component type. IDs are shared by all EntityManagers, so that they may be cached in statics
+		struct ComponentType {
 			size_t id = detail::INVALID;
+			const char * name = nullptr; // Reflected class name
+			std::unique_ptr<ColumnBase>(*makeColumn)(std::pmr::memory_resource *) = nullptr; // Only set for archetype-stored types
+			std::shared_ptr<void>(*makeShared)() = nullptr; // Only set for shared types, creates their default value
+			void(*eraseSparse)(GlobalCompMap &, size_t entityID) = nullptr; // Only set for sparse-set types, releases an Entity's element when it is detached
+		};
+
+		struct ComponentRegistry {
+			std::unordered_map<putils::meta::type_index, std::unique_ptr<ComponentType>> map;
+			std::atomic<const ComponentType *> byID[KENGINE_COMPONENT_COUNT] = {};
+			size_t count = 0; // Protected by `mutex`
+			detail::Mutex mutex;
+		};
+		extern ComponentRegistry * registry;
+
+		// Storage for a Component type in a given EntityManager
+		struct MetadataBase {
 			size_t typeEntityID = detail::INVALID;
+			std::pmr::memory_resource * memory; // The owning EntityManager's
+
+			explicit MetadataBase(std::pmr::memory_resource * memory) : memory(memory) {}
 			virtual ~MetadataBase() = default;
+			// Frees the storage of chunks of entity IDs for which `usedChunks` is false (or out of range). Returns the number of chunks freed
+			virtual size_t releaseChunks(const std::vector<bool> & usedChunks) = 0;
 		};
 
+		// Component storage owned by an EntityManager
 		struct GlobalCompMap {
-			std::unordered_map<putils::meta::type_index, std::unique_ptr<MetadataBase>> map;
+			std::atomic<MetadataBase *> byID[KENGINE_COMPONENT_COUNT] = {}; // Lazily created, so that each EntityManager only pays for the types it uses
+			std::vector<std::unique_ptr<MetadataBase>> owned; // Protected by `mutex`
+			ComponentRegistry * registry = detail::registry;
+			std::pmr::memory_resource * memory = std::pmr::get_default_resource(); // Backs all Component storage, see EntityManager's constructor
+			EntityManager * em = nullptr; // Owner of the archetype columns and shared values
+			std::atomic<uint32_t> changeVersion = 1; // Stamped onto Components on mutable access, see EntityManager::advanceChangeVersion
 			detail::Mutex mutex;
 		};
-		extern GlobalCompMap * components;
+
+		extern thread_local GlobalCompMap * currentComponents; // Set by EntityManager::makeCurrent
+		extern std::atomic<GlobalCompMap *> defaultComponents; // Last live EntityManager created, used by threads which haven't made any current
+
+		// Implemented in Component.cpp. Called by EntityManager's constructor and destructor, so that `defaultComponents` falls back to the last remaining EntityManager
+		void addWorld(GlobalCompMap * components);
+		void removeWorld(GlobalCompMap * components);
+
+		inline GlobalCompMap & getComponents() {
+			auto ret = currentComponents;
+			if (ret == nullptr)
+				ret = defaultComponents.load(std::memory_order_relaxed);
+			assert("No EntityManager is alive" && ret != nullptr);
+			return *ret;
+		}
+
+		// Implemented in EntityManager.cpp. Returns the Entity's element in its archetype's column, or its archetype's shared value
+		void * getArchetypeElement(EntityManager & em, size_t entityID, size_t componentID);
+		// Returns `ids[0]`'s element in its archetype's column, and sets `run` to how many of `ids` have the following rows
+		void * getArchetypeElements(EntityManager & em, const size_t * ids, size_t count, size_t componentID, size_t & run);
 	}
 
 	template<typename Comp>
 	class Component {
 	private:
-		using Chunk = std::vector<Comp>;
+		using Chunk = Comp *; // Array of KENGINE_COMPONENT_CHUNK_SIZE components
+
+		struct ChunkStorage {
+			// Fixed-capacity directory: chunks are published atomically so `get` never has to lock
+			std::atomic<Chunk> chunks[KENGINE_COMPONENT_MAX_CHUNKS] = {};
+
+			explicit ChunkStorage(std::pmr::memory_resource *) {}
+		};
+
+		struct SparseSetStorage {
+			static constexpr uint32_t NoElement = (uint32_t)-1;
+			using Page = uint32_t *; // Array of KENGINE_COMPONENT_CHUNK_SIZE indices into `dense`, or NoElement
 
-		struct Metadata : detail::MetadataBase {
-			std::vector<Chunk> chunks;
-			mutable detail::Mutex _mutex;
+			std::atomic<Page> sparse[KENGINE_COMPONENT_MAX_CHUNKS] = {}; // Published atomically, like ChunkStorage::chunks
+			std::vector<Comp *> dense; // Pages of KENGINE_COMPONENT_CHUNK_SIZE packed components, which never move so that insertions keep references valid. Protected by `_mutex`
+			std::pmr::vector<size_t> ids; // Entity ID of each element of `dense`. Protected by `_mutex`
+
+			explicit SparseSetStorage(std::pmr::memory_resource * memory) : ids(memory) {}
+
+			Comp & at(size_t index) { return dense[index / KENGINE_COMPONENT_CHUNK_SIZE][index % KENGINE_COMPONENT_CHUNK_SIZE]; }
+		};
+
+		using Storage = std::conditional_t<detail::is_sparse_set<Comp>(), SparseSetStorage, ChunkStorage>;
+
+		struct Metadata : detail::MetadataBase, Storage {
+			mutable detail::Mutex _mutex; // Taken to allocate chunks, and to access the sparse set
+			size_t chunkEnd = 0; // One past the highest chunk (or sparse page) allocated, so that chunks aren't all scanned. Protected by `_mutex`
+			std::atomic<uint32_t> versions[KENGINE_COMPONENT_MAX_CHUNKS] = {}; // Change version of the last mutable access to each chunk of entity IDs
+
+			explicit Metadata(std::pmr::memory_resource * memory) : MetadataBase(memory), Storage(memory) {}
+
+			~Metadata() {
+				if constexpr (detail::is_sparse_set<Comp>()) {
+					for (size_t i = 0; i < chunkEnd; ++i)
+						if (const auto p = this->sparse[i].load(std::memory_order_relaxed))
+							detail::deallocateArray(*memory, p, KENGINE_COMPONENT_CHUNK_SIZE);
+					for (const auto page : this->dense)
+						detail::deallocateArray(*memory, page, KENGINE_COMPONENT_CHUNK_SIZE);
+				}
+				else
+					for (size_t i = 0; i < chunkEnd; ++i)
+						if (const auto p = this->chunks[i].load(std::memory_order_relaxed))
+							detail::deallocateArray(*memory, p, KENGINE_COMPONENT_CHUNK_SIZE);
+			}
+
+			size_t releaseChunks(const std::vector<bool> & usedChunks) final {
+				const auto isUsed = [&](size_t chunk) { return chunk < usedChunks.size() && usedChunks[chunk]; };
+				size_t released = 0;
+				size_t newChunkEnd = 0;
+
+				detail::WriteLock l(_mutex);
+				if constexpr (detail::is_sparse_set<Comp>()) {
+					for (size_t i = 0; i < chunkEnd; ++i) {
+						const auto page = this->sparse[i].load(std::memory_order_relaxed);
+						if (page == nullptr)
+							continue;
+						if (isUsed(i) || std::any_of(page, page + KENGINE_COMPONENT_CHUNK_SIZE, [](uint32_t index) { return index != SparseSetStorage::NoElement; })) { // Elements may have been accessed through `get` without being attached
+							newChunkEnd = i + 1;
+							continue;
+						}
+						this->sparse[i].store(nullptr, std::memory_order_relaxed);
+						detail::deallocateArray(*memory, page, KENGINE_COMPONENT_CHUNK_SIZE);
+						++released;
+					}
+
+					const auto usedPages = (this->ids.size() + KENGINE_COMPONENT_CHUNK_SIZE - 1) / KENGINE_COMPONENT_CHUNK_SIZE;
+					released += this->dense.size() - usedPages;
+					for (auto i = usedPages; i < this->dense.size(); ++i)
+						detail::deallocateArray(*memory, this->dense[i], KENGINE_COMPONENT_CHUNK_SIZE);
+					this->dense.resize(usedPages);
+					this->dense.shrink_to_fit();
+					this->ids.shrink_to_fit();
+				}
+				else {
+					for (size_t i = 0; i < chunkEnd; ++i) {
+						const auto chunk = this->chunks[i].load(std::memory_order_relaxed);
+						if (chunk == nullptr)
+							continue;
+						if (isUsed(i)) {
+							newChunkEnd = i + 1;
+							continue;
+						}
+						this->chunks[i].store(nullptr, std::memory_order_relaxed);
+						detail::deallocateArray(*memory, chunk, KENGINE_COMPONENT_CHUNK_SIZE);
+						++released;
+					}
+				}
+				chunkEnd = newChunkEnd;
+				return released;
+			}
 		};
 
 	public:
-		static Comp & get(size_t id) {
+		// Mutable access, marks `id`'s chunk as changed
+		static Comp & get(size_t id) { return get(detail::getComponents(), id); }
+		static const Comp & read(size_t id) { return read(detail::getComponents(), id); }
+		static void markChanged(size_t id) { markChanged(detail::getComponents(), id); }
+		// Change version of the last mutable access to `id`'s chunk
+		static uint32_t getVersion(size_t id) { return getVersion(detail::getComponents(), id); }
+
+		// Overloads for callers which already know the EntityManager, skipping the lookup of the current one
+		static Comp & get(detail::GlobalCompMap & components, size_t id) {
+			if constexpr (std::is_empty<Comp>() || detail::is_archetype_stored<Comp>() || detail::is_shared<Comp>()) {
+				markChanged(components, id);
+				return getStorage(components, id);
+			}
+			else { // Only look the metadata up once
+				auto & meta = metadata(components);
+				markChanged(meta, components.changeVersion.load(std::memory_order_relaxed), id);
+				return getStorage(meta, id);
+			}
+		}
+
+		static const Comp & read(detail::GlobalCompMap & components, size_t id) {
+			return getStorage(components, id);
+		}
+
+		static void markChanged(detail::GlobalCompMap & components, size_t id) {
+			if constexpr (!std::is_empty<Comp>())
+				markChanged(metadata(components), components.changeVersion.load(std::memory_order_relaxed), id);
+		}
+
+		static uint32_t getVersion(detail::GlobalCompMap & components, size_t id) {
+			return metadata(components).versions[id / KENGINE_COMPONENT_CHUNK_SIZE].load(std::memory_order_relaxed);
+		}
+
+		// Mutable access to `ids[0]`'s Component. Sets `run` to how many of `ids` (starting with the first) have their Components
+		// directly following it in memory, so that they may be copied in bulk. Always at least 1
+		static Comp * getRun(const size_t * ids, size_t count, size_t & run) { return getRun(detail::getComponents(), ids, count, run); }
+
+		static Comp * getRun(detail::GlobalCompMap & components, const size_t * ids, size_t count, size_t & run) {
+			run = 1;
+			if constexpr (detail::is_archetype_stored<Comp>()) {
+				static const auto componentID = Component::id();
+				const auto ret = static_cast<Comp *>(detail::getArchetypeElements(*components.em, ids, count, componentID, run));
+				for (size_t i = 0; i < run; ++i)
+					markChanged(components, ids[i]);
+				return ret;
+			}
+			else if constexpr (std::is_empty<Comp>() || detail::is_shared<Comp>() || detail::is_sparse_set<Comp>())
+				return &get(components, ids[0]);
+			else { // Consecutive IDs within a chunk are contiguous
+				const auto chunkEnd = (ids[0] / KENGINE_COMPONENT_CHUNK_SIZE + 1) * KENGINE_COMPONENT_CHUNK_SIZE;
+				while (run < count && ids[run] == ids[0] + run && ids[run] < chunkEnd)
+					++run;
+				return &get(components, ids[0]); // Marks the whole chunk as changed
+			}
+		}
+
+	private:
+		static void markChanged(Metadata & meta, uint32_t version, size_t id) {
+			auto & chunkVersion = meta.versions[id / KENGINE_COMPONENT_CHUNK_SIZE];
+			if (chunkVersion.load(std::memory_order_relaxed) != version) // Avoid writing to a shared cache line when possible
+				chunkVersion.store(version, std::memory_order_relaxed);
+		}
+
+		static Comp & getStorage(detail::GlobalCompMap & components, size_t id) {
 			if constexpr (std::is_empty<Comp>()) {
 				static Comp ret;
 				return ret;
 			}
-			else {
-				static auto & meta = metadata();
-				detail::ReadLock r(meta._mutex);
-
-				if (id >= meta.chunks.size() * KENGINE_COMPONENT_CHUNK_SIZE) {
-					r.unlock(); { // Unlock read so we can get write
-						detail::WriteLock l(meta._mutex);
-						while (id >= meta.chunks.size() * KENGINE_COMPONENT_CHUNK_SIZE)
-							meta.chunks.emplace_back();
-						// Only populate the chunk we need
-						meta.chunks.back().resize(KENGINE_COMPONENT_CHUNK_SIZE);
-					} r.lock(); // Re-lock read
-				}
+			else if constexpr (detail::is_archetype_stored<Comp>() || detail::is_shared<Comp>()) {
+				static const auto componentID = Component::id();
+				return *static_cast<Comp *>(detail::getArchetypeElement(*components.em, id, componentID));
+			}
+			else
+				return getStorage(metadata(components), id);
+		}
+
+		static Comp & getStorage(Metadata & meta, size_t id) {
+			if constexpr (detail::is_sparse_set<Comp>())
+				return getSparseStorage(meta, id);
+			else
+				return getChunkStorage(meta, id);
+		}
+
+		static Comp & getChunkStorage(Metadata & meta, size_t id) {
+			const auto chunkIndex = id / KENGINE_COMPONENT_CHUNK_SIZE;
+			assert("Too many entities, increase KENGINE_COMPONENT_MAX_CHUNKS" && chunkIndex < KENGINE_COMPONENT_MAX_CHUNKS);
 
-				auto & currentChunk = meta.chunks[id / KENGINE_COMPONENT_CHUNK_SIZE];
-				if (currentChunk.empty()) {
-					r.unlock(); {
-						detail::WriteLock l(meta._mutex);
-						currentChunk.resize(KENGINE_COMPONENT_CHUNK_SIZE);
-					} r.lock();
+			auto chunk = meta.chunks[chunkIndex].load(std::memory_order_acquire);
+			if (chunk == nullptr)
+				chunk = allocateChunk(meta, chunkIndex);
+
+			return chunk[id % KENGINE_COMPONENT_CHUNK_SIZE];
+		}
+
+		// Inserts a default-constructed element the first time `id` is accessed
+		static Comp & getSparseStorage(Metadata & meta, size_t id) {
+			const auto pageIndex = id / KENGINE_COMPONENT_CHUNK_SIZE;
+			assert("Too many entities, increase KENGINE_COMPONENT_MAX_CHUNKS" && pageIndex < KENGINE_COMPONENT_MAX_CHUNKS);
+
+			{
+				detail::ReadLock l(meta._mutex);
+				const auto page = meta.sparse[pageIndex].load(std::memory_order_acquire);
+				if (page != nullptr) {
+					const auto index = page[id % KENGINE_COMPONENT_CHUNK_SIZE];
+					if (index != SparseSetStorage::NoElement)
+						return meta.at(index);
 				}
+			}
 
-				return currentChunk[id % KENGINE_COMPONENT_CHUNK_SIZE];
+			detail::WriteLock l(meta._mutex);
+			auto page = meta.sparse[pageIndex].load(std::memory_order_relaxed);
+			if (page == nullptr) {
+				page = detail::allocateArray<uint32_t>(*meta.memory, KENGINE_COMPONENT_CHUNK_SIZE);
+				std::fill(page, page + KENGINE_COMPONENT_CHUNK_SIZE, SparseSetStorage::NoElement);
+				meta.sparse[pageIndex].store(page, std::memory_order_release);
+				meta.chunkEnd = std::max(meta.chunkEnd, pageIndex + 1);
 			}
+
+			auto & index = page[id % KENGINE_COMPONENT_CHUNK_SIZE];
+			if (index == SparseSetStorage::NoElement) { // Might have been inserted by another thread while we waited for the lock
+				index = (uint32_t)meta.ids.size();
+				if (index / KENGINE_COMPONENT_CHUNK_SIZE == meta.dense.size())
+					meta.dense.push_back(detail::allocateArray<Comp>(*meta.memory, KENGINE_COMPONENT_CHUNK_SIZE));
+				meta.ids.push_back(id);
+			}
+			return meta.at(index);
 		}
 
+		// Swaps the last element into `id`'s slot, keeping `dense` packed
+		static void eraseSparse(detail::GlobalCompMap & components, size_t id) {
+			auto & meta = metadata(components);
+			detail::WriteLock l(meta._mutex);
+
+			const auto page = meta.sparse[id / KENGINE_COMPONENT_CHUNK_SIZE].load(std::memory_order_relaxed);
+			if (page == nullptr)
+				return;
+			auto & index = page[id % KENGINE_COMPONENT_CHUNK_SIZE];
+			if (index == SparseSetStorage::NoElement)
+				return;
+
+			const auto last = meta.ids.size() - 1;
+			if (index != last) {
+				const auto movedID = meta.ids.back();
+				meta.at(index) = std::move(meta.at(last));
+				meta.ids[index] = movedID;
+				meta.sparse[movedID / KENGINE_COMPONENT_CHUNK_SIZE].load(std::memory_order_relaxed)[movedID % KENGINE_COMPONENT_CHUNK_SIZE] = index;
+			}
+			meta.at(last) = Comp(); // Release whatever the element owns, the slot is reused by the next insertion
+			meta.ids.pop_back();
+			index = SparseSetStorage::NoElement;
+		}
+
+	public:
 		static size_t id() {
-			static const size_t ret = metadata().id;
+			static const size_t ret = registerType().id;
 			return ret;
 		}
 
+		// Per EntityManager, so must not be cached in a static
 		template<typename Func>
-		static size_t initTypeEntityID(Func && createEntity) {
-			auto & meta = metadata();
+		static size_t typeEntityID(Func && createEntity) { return typeEntityID(detail::getComponents(), std::forward<Func>(createEntity)); }
+
+		template<typename Func>
+		static size_t typeEntityID(detail::GlobalCompMap & components, Func && createEntity) {
+			auto & meta = metadata(components);
 			detail::ReadLock l(meta._mutex);
 			if (meta.typeEntityID == detail::INVALID) {
 				l.unlock();
@@ -105,43 +492,70 @@ namespace kengine {
 			return meta.typeEntityID;
 		}
 
-		template<typename Func>
-		static size_t typeEntityID(Func && createEntity) {
-			static size_t ret = initTypeEntityID(createEntity);
-			return ret;
-		}
-
 		static void setTypeEntityID(size_t id) {
-			metadata().typeEntityID = id;
+			metadata(detail::getComponents()).typeEntityID = id;
 		}
 
 	private:
-		static inline Metadata & metadata() {
-			static Metadata * ret = [] {
-				const auto typeIndex = putils::meta::type<Comp>::index;
-
-				{
-					detail::ReadLock l(detail::components->mutex);
-					const auto it = detail::components->map.find(typeIndex);
-					if (it != detail::components->map.end())
-						return static_cast<Metadata *>(it->second.get());
-				}
+		static Chunk allocateChunk(Metadata & meta, size_t chunkIndex) {
+			detail::WriteLock l(meta._mutex);
+			auto chunk = meta.chunks[chunkIndex].load(std::memory_order_relaxed);
+			if (chunk == nullptr) { // Might have been allocated by another thread while we waited for the lock
+				chunk = detail::allocateArray<Comp>(*meta.memory, KENGINE_COMPONENT_CHUNK_SIZE);
+				meta.chunks[chunkIndex].store(chunk, std::memory_order_release);
+				meta.chunkEnd = std::max(meta.chunkEnd, chunkIndex + 1);
+			}
+			return chunk;
+		}
 
-				auto tmp = std::make_unique<Metadata>();
-				auto ptr = static_cast<Metadata *>(tmp.get());
-				{
-					detail::WriteLock l(detail::components->mutex);
-					detail::components->map[typeIndex] = std::move(tmp);
-					ptr->id = detail::components->map.size() - 1;
-				}
+		static Metadata & metadata(detail::GlobalCompMap & components) {
+			static const auto componentID = id();
+			const auto ret = components.byID[componentID].load(std::memory_order_acquire);
+			if (ret != nullptr)
+				return *static_cast<Metadata *>(ret);
+
+			detail::WriteLock l(components.mutex);
+			auto meta = components.byID[componentID].load(std::memory_order_relaxed);
+			if (meta == nullptr) { // Might have been created by another thread while we waited for the lock
+				components.owned.push_back(std::make_unique<Metadata>(components.memory));
+				meta = components.owned.back().get();
+				components.byID[componentID].store(meta, std::memory_order_release);
+			}
+			return *static_cast<Metadata *>(meta);
+		}
+
+		static const detail::ComponentType & registerType() {
+			auto & registry = *detail::registry;
+			const auto typeIndex = putils::meta::type<Comp>::index;
+
+			{
+				detail::ReadLock l(registry.mutex);
+				const auto it = registry.map.find(typeIndex);
+				if (it != registry.map.end())
+					return *it->second;
+			}
+
+			detail::WriteLock l(registry.mutex);
+			const auto it = registry.map.find(typeIndex);
+			if (it != registry.map.end()) // Might have been registered by another thread between unlock() and lock()
+				return *it->second;
+
+			assert("You are using too many component types." && registry.count < KENGINE_COMPONENT_COUNT);
+			auto type = std::make_unique<detail::ComponentType>();
+			type->id = registry.count++;
+			type->name = putils::reflection::get_class_name<Comp>();
+			if constexpr (detail::is_archetype_stored<Comp>())
+				type->makeColumn = [](std::pmr::memory_resource * memory) { return std::unique_ptr<detail::ColumnBase>(std::make_unique<detail::Column<Comp>>(memory)); };
+			if constexpr (detail::is_shared<Comp>())
+				type->makeShared = [] { return std::shared_ptr<void>(std::make_shared<Comp>()); };
+			if constexpr (detail::is_sparse_set<Comp>())
+				type->eraseSparse = eraseSparse;
+			registry.byID[type->id].store(type.get(), std::memory_order_release);
 
 #ifndef KENGINE_NDEBUG
-				std::cout << putils::termcolor::green << ptr->id << ' ' << putils::termcolor::cyan << putils::reflection::get_class_name<Comp>() << '\n' << putils::termcolor::reset;
+			std::cout << putils::termcolor::green << type->id << ' ' << putils::termcolor::cyan << type->name << '\n' << putils::termcolor::reset;
 #endif
-				return ptr;
-			}();
-
-			return *ret;
+			return *(registry.map[typeIndex] = std::move(type));
 		}
 	};
 }
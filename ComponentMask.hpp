@@ -0,0 +1,162 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif
+
+namespace kengine::detail {
+	// Fixed-size set of Component IDs, stored as 64-bit words plus a summary word telling which of them are non-zero.
+	// Most masks only use a few words, so the summary rejects most mismatches and lets `none()`, `==` and hashing skip empty words
+	template<size_t Size>
+	class ComponentMask {
+	public:
+		static_assert(Size % 64 == 0, "KENGINE_COMPONENT_COUNT must be a multiple of 64");
+		static constexpr size_t WordCount = Size / 64;
+		static_assert(WordCount <= 64, "KENGINE_COMPONENT_COUNT must be at most 4096");
+
+		constexpr size_t size() const { return Size; }
+
+		bool test(size_t bit) const { return (_words[bit / 64] >> (bit % 64)) & 1; }
+		bool operator[](size_t bit) const { return test(bit); }
+
+		ComponentMask & set(size_t bit, bool value = true) {
+			const auto word = bit / 64;
+			const auto flag = uint64_t(1) << (bit % 64);
+			if (value)
+				_words[word] |= flag;
+			else
+				_words[word] &= ~flag;
+			updateSummary(word);
+			return *this;
+		}
+
+		ComponentMask & reset(size_t bit) { return set(bit, false); }
+
+		bool none() const { return _summary == 0; }
+		bool any() const { return _summary != 0; }
+
+		size_t count() const {
+			size_t ret = 0;
+			for (size_t i = 0; i < WordCount; ++i)
+				ret += std::bitset<64>(_words[i]).count();
+			return ret;
+		}
+
+		// Whether all of `other`'s bits are set in `this`
+		bool contains(const ComponentMask & other) const {
+			if ((other._summary & ~_summary) != 0)
+				return false;
+			uint64_t missing = 0;
+			for (size_t i = 0; i < WordCount; ++i) // Branchless so that it gets vectorized
+				missing |= other._words[i] & ~_words[i];
+			return missing == 0;
+		}
+
+		bool intersects(const ComponentMask & other) const {
+			if ((_summary & other._summary) == 0)
+				return false;
+			uint64_t common = 0;
+			for (size_t i = 0; i < WordCount; ++i)
+				common |= _words[i] & other._words[i];
+			return common != 0;
+		}
+
+		bool operator==(const ComponentMask & rhs) const {
+			if (_summary != rhs._summary)
+				return false;
+			uint64_t diff = 0;
+			for (size_t i = 0; i < WordCount; ++i)
+				diff |= _words[i] ^ rhs._words[i];
+			return diff == 0;
+		}
+		bool operator!=(const ComponentMask & rhs) const { return !(*this == rhs); }
+
+		ComponentMask operator&(const ComponentMask & rhs) const {
+			ComponentMask ret;
+			for (size_t i = 0; i < WordCount; ++i)
+				ret._words[i] = _words[i] & rhs._words[i];
+			ret.updateSummary();
+			return ret;
+		}
+
+		ComponentMask operator|(const ComponentMask & rhs) const {
+			ComponentMask ret;
+			for (size_t i = 0; i < WordCount; ++i)
+				ret._words[i] = _words[i] | rhs._words[i];
+			ret._summary = _summary | rhs._summary;
+			return ret;
+		}
+
+		ComponentMask operator~() const {
+			ComponentMask ret;
+			for (size_t i = 0; i < WordCount; ++i)
+				ret._words[i] = ~_words[i];
+			ret.updateSummary();
+			return ret;
+		}
+
+		template<typename Func> // Func: void(size_t bit)
+		void forEachSet(Func && func) const {
+			for (auto summary = _summary; summary != 0; summary &= summary - 1) {
+				const auto word = lowestBit(summary);
+				for (auto bits = _words[word]; bits != 0; bits &= bits - 1)
+					func(word * 64 + lowestBit(bits));
+			}
+		}
+
+		size_t hash() const {
+			size_t ret = std::hash<uint64_t>()(_summary);
+			forEachWord([&](uint64_t word) {
+				ret ^= std::hash<uint64_t>()(word) + 0x9e3779b9 + (ret << 6) + (ret >> 2);
+			});
+			return ret;
+		}
+
+	private:
+		void updateSummary(size_t word) {
+			const auto flag = uint64_t(1) << word;
+			if (_words[word] != 0)
+				_summary |= flag;
+			else
+				_summary &= ~flag;
+		}
+
+		void updateSummary() {
+			_summary = 0;
+			for (size_t i = 0; i < WordCount; ++i)
+				_summary |= uint64_t(_words[i] != 0) << i;
+		}
+
+		template<typename Func>
+		void forEachWord(Func && func) const {
+			for (auto summary = _summary; summary != 0; summary &= summary - 1)
+				func(_words[lowestBit(summary)]);
+		}
+
+		static size_t lowestBit(uint64_t value) { // `value` must be non-zero
+#ifdef _MSC_VER
+			unsigned long ret;
+			_BitScanForward64(&ret, value);
+			return ret;
+#else
+			return __builtin_ctzll(value);
+#endif
+		}
+
+	private:
+		uint64_t _words[WordCount] = {};
+		uint64_t _summary = 0; // Bit `i` is set if `_words[i]` is non-zero
+	};
+}
+
+namespace std {
+	template<size_t Size>
+	struct hash<kengine::detail::ComponentMask<Size>> {
+		size_t operator()(const kengine::detail::ComponentMask<Size> & mask) const { return mask.hash(); }
+	};
+}
@@ -1,25 +1,38 @@
 #pragma once
 
 #include <assert.h>
-#include <bitset>
 #include <cstddef>
+#include <cstdint>
 #include "Component.hpp"
+#include "ComponentMask.hpp"
 #include "reflection.hpp"
 
-#ifndef KENGINE_COMPONENT_COUNT
-# define KENGINE_COMPONENT_COUNT 64
-#endif
-
 namespace kengine {
 	class EntityManager;
 
 	class EntityView {
 	public:
 		using ID = size_t;
-		using Mask = std::bitset<KENGINE_COMPONENT_COUNT>;
+		using Mask = detail::ComponentMask<KENGINE_COMPONENT_COUNT>;
 		static constexpr auto INVALID_ID = detail::INVALID;
 
-		EntityView(ID id = INVALID_ID, Mask componentMask = 0) : id(id), componentMask(componentMask) {}
+		using Generation = uint32_t; // Incremented each time an ID is freed
+		struct Handle { // ID which can be checked for staleness with EntityManager::isAlive
+			ID id = INVALID_ID;
+			Generation generation = 0;
+
+			bool operator==(const Handle & rhs) const { return id == rhs.id && generation == rhs.generation; }
+			bool operator!=(const Handle & rhs) const { return !(*this == rhs); }
+
+			putils_reflection_class_name(Handle);
+			putils_reflection_attributes(
+				putils_reflection_attribute(&Handle::id),
+				putils_reflection_attribute(&Handle::generation)
+			);
+		};
+
+		// `componentMask` must outlive the EntityView. Masks returned by the EntityManager live as long as it does
+		EntityView(ID id = INVALID_ID, const Mask * componentMask = nullptr) : id(id), componentMask(componentMask != nullptr ? componentMask : &emptyMask()) {}
 
 		~EntityView() = default;
 		EntityView(const EntityView &) = default;
@@ -34,16 +47,21 @@ namespace kengine {
 		template<typename T> 
 		const T & get() const {
 			assert("No such component" && has<T>());
-			return Component<T>::get(id);
+			return Component<T>::read(id);
 		}
 
 		template<typename T>
 		bool has() const {
-			return componentMask.test(getId<T>());
+			return componentMask->test(getId<T>());
 		}
 
 		ID id;
-		Mask componentMask = 0;
+		const Mask * componentMask; // Shared by all Entities with the same Components, so that EntityViews stay small however many Component types there are
+
+		static const Mask & emptyMask() {
+			static const Mask ret;
+			return ret;
+		}
 
 	protected:
 		template<typename T>
@@ -56,8 +74,7 @@ namespace kengine {
 	public:
 		putils_reflection_class_name(EntityView);
 		putils_reflection_attributes(
-			putils_reflection_attribute(&EntityView::id),
-			putils_reflection_attribute(&EntityView::componentMask)
+			putils_reflection_attribute(&EntityView::id)
 		);
 		putils_reflection_methods();
 		putils_reflection_parents();
@@ -65,7 +82,7 @@ namespace kengine {
 
 	class Entity : public EntityView {
 	public:
-		Entity(ID id = detail::INVALID, Mask componentMask = 0, EntityManager * manager = nullptr) : EntityView(id, componentMask), manager(manager) {}
+		Entity(ID id = detail::INVALID, const Mask * componentMask = nullptr, EntityManager * manager = nullptr) : EntityView(id, componentMask), manager(manager) {}
 		~Entity() = default;
 		Entity(const Entity &) = default;
 		Entity & operator=(const Entity & rhs) = default;
@@ -84,6 +101,19 @@ namespace kengine {
 		template<typename T>
 		void detach();
 
+		// Unlike EntityView's, these access `manager`'s storage whichever EntityManager is current
+		template<typename T>
+		T & get();
+		template<typename T>
+		const T & get() const;
+
+		// Gives this the `value`th value registered for T through EntityManager::addSharedValue, attaching T if needed
+		template<typename T>
+		void setShared(size_t value);
+
+	private:
+		detail::GlobalCompMap & getComponents() const; // `manager`'s, or the current EntityManager's if this has none
+
 	private:
 		EntityManager * manager;
 	};
@@ -91,12 +121,24 @@ namespace kengine {
 
 #include "EntityManager.hpp"
 
+template<typename T>
+T & kengine::Entity::get() {
+	assert("No such component" && has<T>());
+	return Component<T>::get(getComponents(), id);
+}
+
+template<typename T>
+const T & kengine::Entity::get() const {
+	assert("No such component" && has<T>());
+	return Component<T>::read(getComponents(), id);
+}
+
 template<typename T>
 T & kengine::Entity::attach() {
 	if (!has<T>()) {
 		static const auto component = getId<T>();
-		componentMask.set(component, true);
-		manager->addComponent(id, component);
+		componentMask = manager->addComponent(id, component);
+		manager->notifyAttach(*this, component);
 	}
 	return get<T>();
 }
@@ -105,12 +147,24 @@ template<typename T>
 void kengine::Entity::attach(T && comp) {
 	using Comp = std::decay_t<T>;
 
-	Component<Comp>::get(id) = FWD(comp);
-	if (!has<Comp>()) {
-		static const auto component = getId<Comp>();
-		componentMask.set(component, true);
-		manager->addComponent(id, component);
+	// Assigning would modify the value for the whole archetype, and registering a value per call would give each Entity its own archetype
+	static_assert(!detail::is_shared<Comp>(), "Register shared values once with EntityManager::addSharedValue, then use Entity::setShared");
+
+	if (has<Comp>()) {
+		get<Comp>() = FWD(comp);
+		return;
 	}
+
+	static const auto component = getId<Comp>();
+	if constexpr (detail::is_archetype_stored<Comp>()) { // Storage only exists once the entity has moved to its new archetype
+		componentMask = manager->addComponent(id, component);
+		get<Comp>() = FWD(comp);
+	}
+	else {
+		Component<Comp>::get(manager->_components, id) = FWD(comp);
+		componentMask = manager->addComponent(id, component);
+	}
+	manager->notifyAttach(*this, component);
 }
 
 
@@ -118,6 +172,16 @@ template<typename T>
 void kengine::Entity::detach() {
 	assert("No such component" && has<T>());
 	static const auto component = getId<T>();
-	componentMask.set(component, false);
-	manager->removeComponent(id, component);
+	manager->notifyDetach(*this, component);
+	componentMask = manager->removeComponent(id, component);
+}
+
+template<typename T>
+void kengine::Entity::setShared(size_t value) {
+	static_assert(detail::is_shared<T>(), "Only Components stored as ComponentStorage::Shared have shared values");
+	static const auto component = getId<T>();
+	const bool attaching = !has<T>();
+	componentMask = manager->setSharedValue(id, component, value);
+	if (attaching)
+		manager->notifyAttach(*this, component);
 }
\ No newline at end of file
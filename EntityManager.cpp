@@ -1,4 +1,5 @@
 #include <filesystem>
+#include <stdexcept>
 #include "EntityManager.hpp"
 
 #include "functions/OnTerminate.hpp"
@@ -13,9 +14,22 @@
 #endif
 
 namespace kengine {
+	namespace detail {
+		// Component storage is indexed by Entity ID, and only has room for this many IDs
+		static constexpr size_t MaxEntities = KENGINE_COMPONENT_MAX_CHUNKS * KENGINE_COMPONENT_CHUNK_SIZE;
+
+		static void throwTooManyEntities() {
+			throw std::length_error("kengine: too many Entities, increase KENGINE_COMPONENT_MAX_CHUNKS or KENGINE_COMPONENT_CHUNK_SIZE");
+		}
+	}
+
 	EntityManager::~EntityManager() {
 		for (const auto & [e, func] : getEntities<functions::OnTerminate>())
 			func();
+
+		if (detail::currentComponents == &_components)
+			detail::currentComponents = nullptr;
+		detail::removeWorld(&_components);
 	}
 
 	Entity EntityManager::getEntity(Entity::ID id) {
@@ -28,6 +42,26 @@ namespace kengine {
 		return EntityView(id, _entities[id].mask);
 	}
 
+	Entity::ID EntityManager::getTypeEntityID(size_t component) const {
+		const auto meta = _components.byID[component].load(std::memory_order_acquire);
+		return meta != nullptr ? meta->typeEntityID : Entity::INVALID_ID;
+	}
+
+	Entity::Handle EntityManager::getHandle(Entity::ID id) const {
+		detail::ReadLock l(_entitiesMutex);
+		return { id, _entities[id].generation };
+	}
+
+	bool EntityManager::isAlive(Entity::Handle handle) const {
+		detail::ReadLock l(_entitiesMutex);
+		return handle.id < _entities.size() && _entities[handle.id].generation == handle.generation;
+	}
+
+	size_t EntityManager::getCreationIndex(Entity::ID id) const {
+		detail::ReadLock l(_entitiesMutex);
+		return _entities[id].creationIndex;
+	}
+
 	void EntityManager::removeEntity(EntityView e) {
 		removeEntity(e.id);
 	}
@@ -37,31 +71,44 @@ namespace kengine {
 		for (const auto & [_, func] : getEntities<functions::OnEntityRemoved>())
 			func(e);
 
-		Entity::Mask mask;
-		{
-			detail::ReadLock entities(_entitiesMutex);
-			mask = _entities[id].mask;
-		}
+		e.componentMask->forEachSet([&](size_t component) { notifyDetach(e, component); });
 
-		{
-			detail::ReadLock archetypes(_archetypesMutex);
-			const auto archetype = std::find_if(
-				_archetypes.begin(), _archetypes.end(),
-				[mask](const auto & a) { return a.mask == mask; }
-			);
-			archetype->remove(id);
-		}
+		release(id);
+	}
 
+	void EntityManager::release(Entity::ID id) {
 		{
+			detail::WriteLock archetypes(_archetypesMutex);
+
+			size_t archetype;
+			size_t row;
+			{
+				detail::ReadLock entities(_entitiesMutex);
+				archetype = _entities[id].archetype;
+				row = _entities[id].row;
+			}
+
+			size_t movedEntity = detail::INVALID;
+			if (archetype != detail::INVALID) {
+				movedEntity = _archetypes[archetype].remove(row);
+				for (const auto & [_, eraseSparse] : _archetypes[archetype].sparse)
+					eraseSparse(_components, id);
+			}
+
 			detail::WriteLock entities(_entitiesMutex);
-			_entities[id].mask = 0;
+			if (movedEntity != detail::INVALID)
+				_entities[movedEntity].row = row;
+			_entities[id].mask = nullptr;
 			_entities[id].active = false;
 			_entities[id].shouldActivateAfterInit = true;
+			_entities[id].archetype = detail::INVALID;
+			_entities[id].row = detail::INVALID;
+			++_entities[id].generation;
+			_entities[id].nextFree = _firstFree;
+			_firstFree = id;
 		}
 
-		detail::WriteLock l(_toReuseMutex);
-		_toReuse.emplace_back(id);
-		_toReuseSorted = false;
+		_removedSinceCompaction.fetch_add(1, std::memory_order_relaxed);
 	}
 
 	void EntityManager::setEntityActive(EntityView e, bool active) {
@@ -80,25 +127,22 @@ namespace kengine {
 	};
 
 	Entity EntityManager::alloc() {
-		{
-			detail::ReadLock l(_toReuseMutex);
-			if (_toReuse.empty()) {
-				detail::WriteLock l(_entitiesMutex);
-				const auto id = _entities.size();
-				_entities.push_back({ false, 0 });
-				return Entity(id, 0, this);
-			}
-		}
-
 		Entity::ID id;
 		{
-			detail::WriteLock l(_toReuseMutex);
-			if (!_toReuseSorted) {
-				std::sort(_toReuse.begin(), _toReuse.end(), std::greater<Entity::ID>());
-				_toReuseSorted = true;
+			detail::WriteLock l(_entitiesMutex);
+			if (_firstFree == detail::INVALID) {
+				id = _entities.size();
+				if (id >= detail::MaxEntities)
+					detail::throwTooManyEntities();
+				_entities.emplace_back();
+				_entities[id].creationIndex = _nextCreationIndex++;
+				return Entity(id, nullptr, this);
 			}
-			id = _toReuse.back();
-			_toReuse.pop_back();
+
+			id = _firstFree;
+			_firstFree = _entities[id].nextFree;
+			_entities[id].nextFree = detail::INVALID;
+			_entities[id].creationIndex = _nextCreationIndex++;
 		}
 
 #ifndef KENGINE_NDEBUG
@@ -116,54 +160,511 @@ namespace kengine {
 		}
 #endif
 
-		return Entity(id, 0, this);
+		return Entity(id, nullptr, this);
+	}
+
+	void EntityManager::allocMany(size_t count, std::vector<Entity::ID> & ids) {
+		ids.reserve(count);
+
+		detail::WriteLock l(_entitiesMutex);
+		while (ids.size() < count && _firstFree != detail::INVALID) {
+			const auto id = _firstFree;
+			_firstFree = _entities[id].nextFree;
+			_entities[id].nextFree = detail::INVALID;
+			ids.push_back(id);
+		}
+
+		const auto remaining = count - ids.size();
+		const auto first = _entities.size();
+		if (remaining > detail::MaxEntities - first) {
+			// Give the recycled IDs back so that the EntityManager is left untouched
+			for (auto it = ids.rbegin(); it != ids.rend(); ++it) {
+				_entities[*it].nextFree = _firstFree;
+				_firstFree = *it;
+			}
+			ids.clear();
+			detail::throwTooManyEntities();
+		}
+		_entities.resize(first + remaining);
+		for (size_t i = 0; i < remaining; ++i)
+			ids.push_back(first + i);
+
+		for (const auto id : ids)
+			_entities[id].creationIndex = _nextCreationIndex++;
 	}
 
-	void EntityManager::addComponent(Entity::ID id, size_t component) {
-		updateHasComponent(id, component, true);
+	bool EntityManager::createEntities(size_t count, const Entity::Mask & mask, const std::function<bool(const std::vector<Entity::ID> & ids)> & init) {
+		std::vector<Entity::ID> ids;
+		allocMany(count, ids);
+		addMany(ids, mask);
+		if (!init(ids)) {
+			// Nobody has seen these Entities yet, so they're dropped silently
+			for (const auto id : ids)
+				release(id);
+			return false;
+		}
+		notifyCreated(ids, mask);
+		return true;
 	}
 
-	void EntityManager::removeComponent(Entity::ID id, size_t component) {
-		updateHasComponent(id, component, false);
+	void EntityManager::notifyCreated(const std::vector<Entity::ID> & ids, const Entity::Mask & mask) {
+		mask.forEachSet([&](size_t component) {
+			const auto observers = getObservers(component, true);
+			if (observers != nullptr)
+				for (const auto id : ids) {
+					auto e = getEntity(id);
+					for (const auto & observer : *observers)
+						observer(e);
+				}
+		});
+
+		for (const auto & [_, f] : getEntities<functions::OnEntityCreated>())
+			for (const auto id : ids) {
+				auto e = getEntity(id);
+				f(e);
+			}
+
+		detail::WriteLock l(_entitiesMutex);
+		for (const auto id : ids)
+			_entities[id].active = _entities[id].shouldActivateAfterInit;
 	}
 
-	void EntityManager::updateHasComponent(Entity::ID id, size_t component, bool newHasComponent) {
-		Entity::Mask oldMask;
+	void EntityManager::addMany(const std::vector<Entity::ID> & ids, const Entity::Mask & mask) {
+		if (ids.empty() || mask.none())
+			return;
+
+		detail::WriteLock archetypes(_archetypesMutex);
+		const auto archetype = getArchetypeIndex(makeKey(mask, detail::INVALID));
+		const auto firstRow = _archetypes[archetype].addMany(ids);
+
+		detail::WriteLock l(_entitiesMutex);
+		for (size_t i = 0; i < ids.size(); ++i) {
+			auto & entity = _entities[ids[i]];
+			entity.mask = _archetypes[archetype].mask;
+			entity.archetype = archetype;
+			entity.row = firstRow + i;
+		}
+	}
+
+	const Entity::Mask * EntityManager::addComponent(Entity::ID id, size_t component) {
+		return updateHasComponent(id, component, true);
+	}
+
+	const Entity::Mask * EntityManager::removeComponent(Entity::ID id, size_t component) {
+		return updateHasComponent(id, component, false);
+	}
+
+	const Entity::Mask * EntityManager::updateHasComponent(Entity::ID id, size_t component, bool newHasComponent) {
+		detail::WriteLock archetypes(_archetypesMutex);
+
+		Entity::Mask updatedMask;
+		{
+			detail::ReadLock l(_entitiesMutex);
+			if (_entities[id].mask != nullptr)
+				updatedMask = *_entities[id].mask;
+		}
+		assert(updatedMask[component] != newHasComponent);
+		updatedMask.set(component, newHasComponent);
+
+		return setMask(id, updatedMask, component);
+	}
+
+	const Entity::Mask * EntityManager::setMask(Entity::ID id, const Entity::Mask & updatedMask, size_t component) {
+		size_t oldArchetype;
+		size_t oldRow;
 		{
 			detail::ReadLock l(_entitiesMutex);
-			oldMask = _entities[id].mask;
+			const auto & entity = _entities[id];
+			oldArchetype = entity.archetype;
+			oldRow = entity.row;
 		}
 
-		auto updatedMask = oldMask;
-		updatedMask[component] = newHasComponent;
+		size_t updatedArchetype = detail::INVALID;
+		if (updatedMask.any())
+			updatedArchetype = oldArchetype != detail::INVALID && component != detail::INVALID ?
+				getNeighborArchetypeIndex(oldArchetype, component, updatedMask) :
+				getArchetypeIndex(makeKey(updatedMask, oldArchetype));
 
-		assert(oldMask != updatedMask);
+		return moveToArchetype(id, oldArchetype, oldRow, updatedArchetype);
+	}
 
-		if (oldMask != 0) {
-			detail::ReadLock l(_archetypesMutex);
+	const Entity::Mask * EntityManager::setSharedValue(Entity::ID id, size_t component, size_t value) {
+		detail::WriteLock archetypes(_archetypesMutex);
+
+		size_t oldArchetype;
+		size_t oldRow;
+		{
+			detail::ReadLock l(_entitiesMutex);
+			const auto & entity = _entities[id];
+			oldArchetype = entity.archetype;
+			oldRow = entity.row;
+		}
+
+		auto updatedMask = oldArchetype != detail::INVALID ? *_archetypes[oldArchetype].mask : Entity::Mask{};
+		updatedMask.set(component);
+		auto key = makeKey(updatedMask, oldArchetype);
+		for (auto & [sharedComponent, sharedValue] : key.shared)
+			if (sharedComponent == component)
+				sharedValue = value;
+
+		findSharedValue(component, value); // Check that `value` exists
+		const auto updatedArchetype = getArchetypeIndex(key);
+		if (updatedArchetype == oldArchetype)
+			return _archetypes[oldArchetype].mask;
+		return moveToArchetype(id, oldArchetype, oldRow, updatedArchetype);
+	}
+
+	const Entity::Mask * EntityManager::moveToArchetype(Entity::ID id, size_t oldArchetype, size_t oldRow, size_t updatedArchetype) {
+		size_t updatedRow = detail::INVALID;
+		if (updatedArchetype != detail::INVALID) {
+			// Get `previous` after any insertion, as it may have moved the archetypes
+			const auto previous = oldArchetype != detail::INVALID ? &_archetypes[oldArchetype] : nullptr;
+			updatedRow = _archetypes[updatedArchetype].add(id, previous, oldRow);
+		}
+
+		size_t movedEntity = detail::INVALID;
+		if (oldArchetype != detail::INVALID) {
+			movedEntity = _archetypes[oldArchetype].remove(oldRow);
+			for (const auto & [component, eraseSparse] : _archetypes[oldArchetype].sparse)
+				if (updatedArchetype == detail::INVALID || !_archetypes[updatedArchetype].mask->test(component))
+					eraseSparse(_components, id);
+		}
+
+		detail::WriteLock l(_entitiesMutex);
+		if (movedEntity != detail::INVALID)
+			_entities[movedEntity].row = oldRow;
+		auto & entity = _entities[id];
+		entity.mask = updatedArchetype != detail::INVALID ? _archetypes[updatedArchetype].mask : nullptr;
+		entity.archetype = updatedArchetype;
+		entity.row = updatedRow;
+		return entity.mask;
+	}
+
+	void EntityManager::addObserver(size_t component, bool attach, Observer && observer) {
+		detail::WriteLock l(_observersMutex);
+		if (component >= _observers.size())
+			_observers.resize(component + 1);
+
+		auto & current = attach ? _observers[component].onAttach : _observers[component].onDetach;
+		auto updated = current != nullptr ? std::make_shared<ObserverList>(*current) : std::make_shared<ObserverList>();
+		updated->push_back(std::move(observer));
+		current = std::move(updated);
+	}
+
+	std::shared_ptr<const EntityManager::ObserverList> EntityManager::getObservers(size_t component, bool attach) const {
+		detail::ReadLock l(_observersMutex);
+		if (component >= _observers.size())
+			return nullptr;
+		return attach ? _observers[component].onAttach : _observers[component].onDetach;
+	}
+
+	void EntityManager::notifyAttach(Entity & e, size_t component) const {
+		const auto observers = getObservers(component, true);
+		if (observers != nullptr)
+			for (const auto & observer : *observers)
+				observer(e);
+	}
+
+	void EntityManager::notifyDetach(Entity & e, size_t component) const {
+		const auto observers = getObservers(component, false);
+		if (observers != nullptr)
+			for (const auto & observer : *observers)
+				observer(e);
+	}
+
+	CommandBuffer & EntityManager::getCommandBuffer() {
+		thread_local std::unordered_map<size_t, CommandBuffer *> buffers; // Indexed by EntityManager::_uid
+		auto & buffer = buffers[_uid];
+		if (buffer == nullptr) {
+			detail::WriteLock l(_commandBuffersMutex);
+			_commandBuffers.push_back(std::make_unique<CommandBuffer>());
+			buffer = _commandBuffers.back().get();
+		}
+		return *buffer;
+	}
 
-			const auto archetype = std::find_if(
-				_archetypes.begin(), _archetypes.end(),
-				[oldMask](const auto & a) { return a.mask == oldMask; }
-			);
-			archetype->remove(id);
+	void EntityManager::playbackCommands() {
+		using Command = CommandBuffer::Command;
+
+		std::vector<Command> commands;
+		std::vector<std::function<void(Entity &)>> creations;
+		{
+			detail::WriteLock l(_commandBuffersMutex);
+			for (const auto & buffer : _commandBuffers)
+				if (buffer->_hasCommands)
+					buffer->take(commands, creations);
 		}
 
-		if (updatedMask != 0) {
+		// Group commands by entity, keeping each thread's commands in the order they were recorded
+		std::stable_sort(commands.begin(), commands.end(), [](const Command & lhs, const Command & rhs) { return lhs.id < rhs.id; });
+
+		struct Move {
+			Entity::ID id;
+			Entity::Mask oldMask;
+			Entity::Mask mask;
+		};
+
+		std::vector<Entity::ID> removed;
+		std::vector<Move> moves;
+		for (size_t begin = 0; begin < commands.size();) {
+			const auto id = commands[begin].id;
+			auto end = begin;
+			bool remove = false;
+			while (end < commands.size() && commands[end].id == id) {
+				remove |= commands[end].type == Command::Type::Remove;
+				++end;
+			}
+
+			if (remove)
+				removed.push_back(id);
+			else {
+				Entity::Mask mask;
+				{
+					detail::ReadLock l(_entitiesMutex);
+					if (_entities[id].mask != nullptr)
+						mask = *_entities[id].mask;
+				}
+				const auto oldMask = mask;
+				for (auto i = begin; i < end; ++i)
+					mask.set(commands[i].component, commands[i].type == Command::Type::Attach);
+				if (mask != oldMask)
+					moves.push_back({ id, oldMask, mask });
+			}
+
+			begin = end;
+		}
+
+		for (const auto & move : moves) {
+			const auto detached = move.oldMask & ~move.mask;
+			if (detached.none())
+				continue;
+			auto e = getEntity(move.id);
+			detached.forEachSet([&](size_t component) { notifyDetach(e, component); });
+		}
+
+		// Each entity changes archetype at most once, whatever the number of Components attached and detached
+		if (!moves.empty()) {
 			detail::WriteLock l(_archetypesMutex);
+			for (const auto & move : moves)
+				setMask(move.id, move.mask);
+		}
 
-			const auto archetype = std::find_if(
-				_archetypes.begin(), _archetypes.end(),
-				[updatedMask](const auto & a) { return a.mask == updatedMask; }
-			);
-			if (archetype != _archetypes.end())
-				archetype->add(id);
-			else
-				_archetypes.emplace_back(updatedMask, id);
+		size_t nextRemoved = 0;
+		for (auto & command : commands) {
+			while (nextRemoved < removed.size() && removed[nextRemoved] < command.id)
+				++nextRemoved;
+			if (nextRemoved < removed.size() && removed[nextRemoved] == command.id)
+				continue;
+			if (command.assign != nullptr)
+				command.assign(_components, command.id);
+		}
+
+		for (const auto & move : moves) {
+			const auto attached = move.mask & ~move.oldMask;
+			if (attached.none())
+				continue;
+			auto e = getEntity(move.id);
+			attached.forEachSet([&](size_t component) { notifyAttach(e, component); });
+		}
+
+		for (const auto id : removed)
+			removeEntity(id);
+
+		// Commands recorded by these (or by OnEntityCreated callbacks) wait for the next call
+		for (auto & creation : creations)
+			createEntity(creation);
+
+		const auto autoCompaction = _autoCompaction.load(std::memory_order_relaxed);
+		if (autoCompaction != 0 && _removedSinceCompaction.load(std::memory_order_relaxed) >= autoCompaction)
+			compact();
+	}
+
+	size_t EntityManager::compact() {
+		_removedSinceCompaction = 0;
+
+		// Chunks of entity IDs still holding each Component
+		std::vector<std::vector<bool>> usedChunks(KENGINE_COMPONENT_COUNT);
+		{
+			detail::WriteLock archetypes(_archetypesMutex);
+			for (auto & archetype : _archetypes) {
+				archetype.shrinkToFit();
+				archetype.mask->forEachSet([&](size_t component) {
+					auto & used = usedChunks[component];
+					for (const auto id : archetype.entities) {
+						const auto chunk = id / KENGINE_COMPONENT_CHUNK_SIZE;
+						if (chunk >= used.size())
+							used.resize(chunk + 1);
+						used[chunk] = true;
+					}
+				});
+			}
+		}
+
+		size_t released = 0;
+		{
+			detail::ReadLock l(_components.mutex);
+			for (size_t component = 0; component < KENGINE_COMPONENT_COUNT; ++component) {
+				const auto meta = _components.byID[component].load(std::memory_order_acquire);
+				if (meta != nullptr)
+					released += meta->releaseChunks(usedChunks[component]);
+			}
 		}
 
+		// Rebuild the free list in ascending order, so that new Entities fill the low chunks back up instead of keeping high ones alive
 		detail::WriteLock l(_entitiesMutex);
-		_entities[id].mask = updatedMask;
+		std::vector<bool> isFree(_entities.size());
+		for (auto id = _firstFree; id != detail::INVALID; id = _entities[id].nextFree)
+			isFree[id] = true;
+
+		_firstFree = detail::INVALID;
+		for (auto id = _entities.size(); id-- > 0;)
+			if (isFree[id]) {
+				_entities[id].nextFree = _firstFree;
+				_firstFree = id;
+			}
+
+		return released;
+	}
+
+	size_t EntityManager::getArchetypeIndex(const ArchetypeKey & key) {
+		const auto it = _archetypeIndices.find(key);
+		if (it != _archetypeIndices.end())
+			return it->second;
+
+		const auto index = _archetypes.size();
+		const auto & inserted = _archetypeIndices.emplace(key, index).first->first;
+		auto & archetype = _archetypes.emplace_back(inserted, _components);
+		for (const auto & [component, value] : inserted.shared)
+			archetype.shared.emplace_back(component, findSharedValue(component, value));
+
+		for (auto & [_, query] : _queries)
+			if (query.matches(key.mask))
+				query.archetypes.push_back(index);
+
+		return index;
+	}
+
+	EntityManager::ArchetypeKey EntityManager::makeKey(const Entity::Mask & mask, size_t previousArchetype) const {
+		ArchetypeKey key{ mask, {} };
+		mask.forEachSet([&](size_t component) {
+			if (_components.registry->byID[component].load(std::memory_order_acquire)->makeShared == nullptr)
+				return;
+
+			size_t value = 0;
+			if (previousArchetype != detail::INVALID)
+				for (const auto & [previousComponent, previousValue] : _archetypes[previousArchetype].key->shared)
+					if (previousComponent == component)
+						value = previousValue;
+			key.shared.emplace_back(component, value);
+		});
+		return key;
+	}
+
+	size_t EntityManager::addSharedValue(size_t component, std::shared_ptr<void> && value) {
+		detail::WriteLock l(_archetypesMutex);
+		findSharedValue(component, 0); // Make sure the default value comes first
+		auto & values = _sharedValues[component];
+		values.push_back(std::move(value));
+		return values.size() - 1;
+	}
+
+	void * EntityManager::findSharedValue(size_t component, size_t index) {
+		if (component >= _sharedValues.size())
+			_sharedValues.resize(component + 1);
+
+		auto & values = _sharedValues[component];
+		if (values.empty())
+			values.push_back(_components.registry->byID[component].load(std::memory_order_acquire)->makeShared());
+		assert("No such shared value" && index < values.size());
+		return values[index].get();
+	}
+
+	const EntityManager::Query & EntityManager::getQuery(const Entity::Mask & include, const Entity::Mask & exclude) {
+		const auto key = std::make_pair(include, exclude);
+		{
+			detail::ReadLock l(_archetypesMutex);
+			const auto it = _queries.find(key);
+			if (it != _queries.end())
+				return it->second;
+		}
+
+		detail::WriteLock l(_archetypesMutex);
+		const auto [it, inserted] = _queries.try_emplace(key);
+		auto & query = it->second;
+		if (inserted) { // Might have been created by another thread between unlock() and lock()
+			query.include = include;
+			query.exclude = exclude;
+			for (size_t i = 0; i < _archetypes.size(); ++i)
+				if (query.matches(*_archetypes[i].mask))
+					query.archetypes.push_back(i);
+		}
+		return query;
+	}
+
+	size_t EntityManager::getNeighborArchetypeIndex(size_t archetype, size_t component, const Entity::Mask & neighborMask) {
+		for (const auto & [edgeComponent, neighbor] : _archetypes[archetype].edges)
+			if (edgeComponent == component)
+				return neighbor;
+
+		const auto neighbor = getArchetypeIndex(makeKey(neighborMask, archetype));
+		// Only one of attaching or detaching `component` is possible from a given archetype, so `component` is enough as a key
+		_archetypes[archetype].edges.emplace_back(component, neighbor);
+		return neighbor;
+	}
+
+	void * EntityManager::getArchetypeElement(Entity::ID id, size_t component) {
+		detail::ReadLock archetypes(_archetypesMutex);
+
+		size_t archetypeIndex;
+		size_t row;
+		{
+			detail::ReadLock l(_entitiesMutex);
+			archetypeIndex = _entities[id].archetype;
+			row = _entities[id].row;
+		}
+		assert("No such component" && archetypeIndex != detail::INVALID);
+
+		const auto & archetype = _archetypes[archetypeIndex];
+		detail::ReadLock l(archetype.mutex);
+		const auto column = archetype.getColumn(component);
+		if (column != nullptr)
+			return column->at(row);
+
+		const auto shared = archetype.getShared(component);
+		assert("No such component" && shared != nullptr);
+		return shared;
+	}
+
+	void * EntityManager::getArchetypeElements(const Entity::ID * ids, size_t count, size_t component, size_t & run) {
+		detail::ReadLock archetypes(_archetypesMutex);
+
+		size_t archetypeIndex;
+		size_t row;
+		{
+			detail::ReadLock l(_entitiesMutex);
+			archetypeIndex = _entities[ids[0]].archetype;
+			row = _entities[ids[0]].row;
+			run = 1;
+			while (run < count && _entities[ids[run]].archetype == archetypeIndex && _entities[ids[run]].row == row + run)
+				++run;
+		}
+		assert("No such component" && archetypeIndex != detail::INVALID);
+
+		const auto & archetype = _archetypes[archetypeIndex];
+		detail::ReadLock l(archetype.mutex);
+		const auto column = archetype.getColumn(component);
+		assert("No such component" && column != nullptr);
+		return column->at(row);
+	}
+
+	namespace detail {
+		void * getArchetypeElement(EntityManager & em, size_t entityID, size_t componentID) {
+			return em.getArchetypeElement(entityID, componentID);
+		}
+
+		void * getArchetypeElements(EntityManager & em, const size_t * ids, size_t count, size_t componentID, size_t & run) {
+			return em.getArchetypeElements(ids, count, componentID, run);
+		}
 	}
 
 	/*
@@ -177,7 +678,7 @@ namespace kengine {
 	EntityManager::EntityCollection::EntityIterator & EntityManager::EntityCollection::EntityIterator::operator++() {
 		++index;
 		detail::ReadLock l(em._entitiesMutex);
-		while (index < em._entities.size() && (em._entities[index].mask == 0 || !em._entities[index].active))
+		while (index < em._entities.size() && (em._entities[index].mask == nullptr || !em._entities[index].active))
 			++index;
 		return *this;
 	}
@@ -195,7 +696,7 @@ namespace kengine {
 	EntityManager::EntityCollection::EntityIterator EntityManager::EntityCollection::begin() const {
 		size_t i = 0;
 		detail::ReadLock l(em._entitiesMutex);
-		while (i < em._entities.size() && (em._entities[i].mask == 0 || !em._entities[i].active))
+		while (i < em._entities.size() && (em._entities[i].mask == nullptr || !em._entities[i].active))
 			++i;
 		return EntityIterator{ i, em };
 	}
@@ -209,42 +710,84 @@ namespace kengine {
 	** Archetype
 	*/
 
-	EntityManager::Archetype::Archetype(Entity::Mask mask, Entity::ID firstEntity)
-		: mask(mask), entities({ firstEntity })
-	{}
+	EntityManager::Archetype::Archetype(const ArchetypeKey & key, const detail::GlobalCompMap & components)
+		: key(&key), mask(&key.mask), entities(components.memory)
+	{
+		key.mask.forEachSet([&](size_t i) {
+			const auto type = components.registry->byID[i].load(std::memory_order_acquire);
+			if (type->makeColumn != nullptr)
+				columns.emplace_back(i, type->makeColumn(components.memory));
+			if (type->eraseSparse != nullptr)
+				sparse.emplace_back(i, type->eraseSparse);
+		});
+	}
 
-	EntityManager::Archetype::Archetype(Archetype && rhs) {
+	EntityManager::Archetype::Archetype(Archetype && rhs)
+		: entities(rhs.entities.get_allocator()) // So that moving doesn't copy them to the default resource
+	{
+		key = rhs.key;
 		mask = rhs.mask;
-		sorted = rhs.sorted;
 		detail::WriteLock l(rhs.mutex);
 		entities = std::move(rhs.entities);
+		columns = std::move(rhs.columns);
+		shared = std::move(rhs.shared);
+		sparse = std::move(rhs.sparse);
+		edges = std::move(rhs.edges);
 	}
 
-	EntityManager::Archetype::Archetype(const Archetype & rhs) {
-		mask = rhs.mask;
-		sorted = rhs.sorted;
-		detail::ReadLock l(rhs.mutex);
-		entities = rhs.entities;
+	size_t EntityManager::Archetype::add(Entity::ID id, Archetype * previous, size_t previousRow) {
+		detail::WriteLock l(mutex);
+
+		if (!columns.empty()) {
+			// Only one thread can hold two archetype locks at once, as structural changes hold `_archetypesMutex`
+			std::unique_lock<detail::Mutex> previousLock;
+			if (previous != nullptr && !previous->columns.empty())
+				previousLock = std::unique_lock<detail::Mutex>(previous->mutex);
+			else
+				previous = nullptr;
+
+			for (const auto & [component, column] : columns) {
+				const auto previousColumn = previous != nullptr ? previous->getColumn(component) : nullptr;
+				if (previousColumn != nullptr)
+					previousColumn->moveRowTo(previousRow, *column);
+				else
+					column->emplaceDefault();
+			}
+		}
+
+		entities.push_back(id);
+		return entities.size() - 1;
 	}
 
-	void EntityManager::Archetype::add(Entity::ID id) {
+	size_t EntityManager::Archetype::addMany(const std::vector<Entity::ID> & ids) {
 		detail::WriteLock l(mutex);
-		entities.push_back(id);
-		sorted = false;
+
+		for (const auto & [_, column] : columns)
+			column->emplaceDefaults(ids.size());
+
+		const auto firstRow = entities.size();
+		entities.insert(entities.end(), ids.begin(), ids.end());
+		return firstRow;
 	}
 
-	void EntityManager::Archetype::remove(Entity::ID id) {
+	Entity::ID EntityManager::Archetype::remove(size_t row) {
 		detail::WriteLock l(mutex);
-		if (!sorted)
-			sort();
-		const auto it = std::lower_bound(entities.begin(), entities.end(), id);
-		std::swap(*it, entities.back());
+
+		const auto last = entities.size() - 1;
+		const auto movedEntity = row != last ? entities.back() : detail::INVALID;
+
+		entities[row] = entities.back();
 		entities.pop_back();
-		sorted = false;
+		for (const auto & [_, column] : columns)
+			column->swapRemove(row);
+
+		return movedEntity;
 	}
 
-	void EntityManager::Archetype::sort() {
-		std::sort(entities.begin(), entities.end(), std::less<Entity::ID>());
-		sorted = true;
+	void EntityManager::Archetype::shrinkToFit() {
+		detail::WriteLock l(mutex);
+		entities.shrink_to_fit();
+		for (const auto & [_, column] : columns)
+			column->shrinkToFit();
 	}
-}
\ No newline at end of file
+}
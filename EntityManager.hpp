@@ -1,12 +1,24 @@
 #pragma once
 
 #include <vector>
+#include <tuple>
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <memory>
+#include <memory_resource>
+#include <functional>
 #include "Component.hpp"
 #include "Entity.hpp"
-#include "ThreadPool.hpp"
+#include "WorkStealingPool.hpp"
+#include "CommandBuffer.hpp"
 #include "EntityCreator.hpp"
 #include "functions/OnEntityCreated.hpp"
 
+#ifndef KENGINE_PARALLEL_FOR_EACH_GRAIN_SIZE
+# define KENGINE_PARALLEL_FOR_EACH_GRAIN_SIZE 64
+#endif
+
 namespace kengine {
 	template<typename T>
 	struct no {
@@ -19,13 +31,59 @@ namespace kengine {
 	template<typename T>
 	struct is_not<no<T>> : std::true_type {};
 
-    class EntityManager : public putils::ThreadPool {
+	// Filters out Entities whose T hasn't been accessed mutably since a given change version. Iterated as `const T &`
+	template<typename T>
+	struct Changed {
+		using CompType = T;
+	};
+
+	template<typename>
+	struct is_changed : std::false_type {};
+
+	template<typename T>
+	struct is_changed<Changed<T>> : std::true_type {};
+
+	namespace detail {
+		template<typename T>
+		struct iterated_type { using type = T; };
+
+		template<typename T>
+		struct iterated_type<Changed<T>> { using type = const T; };
+
+		template<typename T>
+		using iterated_type_t = typename iterated_type<T>::type;
+	}
+
+    class EntityManager : public WorkStealingPool {
     public:
-		EntityManager(size_t threads = 0) : ThreadPool(threads) {
-			detail::components = &_components;
+		// `memory` backs all Component storage and archetype entity lists, and must outlive the EntityManager. It must be thread-safe unless the EntityManager is only used from one thread (KENGINE_SINGLE_THREADED, or no worker threads)
+		EntityManager(size_t threads = 0, std::pmr::memory_resource * memory = std::pmr::get_default_resource()) : WorkStealingPool(threads), _uid(s_nextUid++) {
+#ifdef KENGINE_SINGLE_THREADED
+			assert("KENGINE_SINGLE_THREADED EntityManagers can't have worker threads" && threads == 0);
+#endif
+			_components.memory = memory;
+			_components.em = this;
+			detail::addWorld(&_components);
+			makeCurrent();
 		}
 		~EntityManager();
 
+		// Component accesses from the calling thread will target this EntityManager. Called by the constructor, by MainLoop, and before running this EntityManager's tasks
+		void makeCurrent() { detail::currentComponents = &_components; }
+
+		// Hides WorkStealingPool::runTask, so that tasks access this EntityManager's Components whichever thread runs them
+		template<typename F>
+		auto runTask(F && f) {
+			return WorkStealingPool::runTask([this, f = FWD(f)]() mutable {
+				const auto previous = std::exchange(detail::currentComponents, &_components);
+				struct Restore {
+					detail::GlobalCompMap * previous;
+					~Restore() { detail::currentComponents = previous; }
+				} restore{ previous };
+				return f();
+			});
+		}
+
     public:
 		template<typename Func> // Func: kengine::EntityCreator
         Entity createEntity(Func && postCreate) {
@@ -45,6 +103,44 @@ namespace kengine {
 			return e;
         }
 
+		template<typename ... Comps, typename Func> // Func: void(Entity &, Comps &...)
+		void createEntities(size_t count, Func && init) {
+			static const auto mask = [] {
+				Entity::Mask ret;
+				putils::for_each_type<Comps...>([&](auto && type) {
+					using T = putils_wrapped_type(type);
+					ret.set(Component<T>::id());
+				});
+				return ret;
+			}();
+
+			std::vector<Entity::ID> ids;
+			allocMany(count, ids);
+
+			// Recycled IDs may still hold a previous entity's chunk-stored Components
+			putils::for_each_type<Comps...>([&](auto && type) {
+				using T = putils_wrapped_type(type);
+				if constexpr (!detail::is_archetype_stored<T>() && !detail::is_shared<T>())
+					for (const auto id : ids)
+						Component<T>::get(_components, id) = T{};
+			});
+
+			// Place entities directly in their final archetype
+			addMany(ids, mask);
+
+			for (const auto id : ids) {
+				Entity e(id, &mask, this);
+				init(e, e.get<Comps>()...);
+			}
+
+			notifyCreated(ids, mask);
+		}
+
+		// Untyped version, for callers which only know Component IDs at runtime (e.g. SnapshotHelper)
+		// `init` must assign all the new Entities' Components, as recycled IDs may still hold previous values
+		// If `init` returns false, the new Entities are removed without ever being announced, and createEntities returns false
+		bool createEntities(size_t count, const Entity::Mask & mask, const std::function<bool(const std::vector<Entity::ID> & ids)> & init);
+
 		template<typename Func>
 		Entity operator+=(Func && postCreate) {
 			return createEntity(FWD(postCreate));
@@ -54,6 +150,12 @@ namespace kengine {
 		Entity getEntity(Entity::ID id);
 		EntityView getEntity(Entity::ID id) const;
 
+		Entity::Handle getHandle(Entity::ID id) const;
+		bool isAlive(Entity::Handle handle) const;
+
+		// Increases with each created Entity, unlike IDs which are recycled
+		size_t getCreationIndex(Entity::ID id) const;
+
     public:
 		void removeEntity(EntityView e);
 		void removeEntity(Entity::ID id);
@@ -62,54 +164,156 @@ namespace kengine {
 		void setEntityActive(EntityView e, bool active);
 		void setEntityActive(Entity::ID id, bool active);
 
+	public:
+		// Func: void(Entity &, T &)
+		// Called after a T is attached to an Entity which didn't have one, once it holds its value
+		template<typename T, typename Func>
+		void onAttach(Func && func) {
+			addObserver(Component<T>::id(), true, [func = FWD(func)](Entity & e) { func(e, e.get<T>()); });
+		}
+
+		// Func: void(Entity &, T &)
+		// Called before a T is detached from an Entity, including when the Entity is removed
+		template<typename T, typename Func>
+		void onDetach(Func && func) {
+			addObserver(Component<T>::id(), false, [func = FWD(func)](Entity & e) { func(e, e.get<T>()); });
+		}
+
+	public:
+		// Registers a value for a Shared Component, to be given to Entities with Entity::setShared. Values live as long as the EntityManager
+		template<typename T>
+		size_t addSharedValue(T && value) {
+			using Comp = std::decay_t<T>;
+			static_assert(detail::is_shared<Comp>(), "Only Components stored as ComponentStorage::Shared have shared values");
+			return addSharedValue(Component<Comp>::id(), std::make_shared<Comp>(FWD(value)));
+		}
+
+		// Index 0 is the default value, given to Entities which attach a T without choosing a value
+		template<typename T>
+		T & getSharedValue(size_t index) {
+			static_assert(detail::is_shared<T>(), "Only Components stored as ComponentStorage::Shared have shared values");
+			detail::WriteLock l(_archetypesMutex);
+			return *static_cast<T *>(findSharedValue(Component<T>::id(), index));
+		}
+
+	public:
+		// World-wide instance of T, default-constructed on first access. References remain valid until removeResource<T>
+		template<typename T>
+		T & resource() {
+			static const auto index = Component<T>::id();
+			{
+				detail::ReadLock l(_resourcesMutex);
+				if (index < _resources.size() && _resources[index] != nullptr)
+					return *static_cast<T *>(_resources[index].get());
+			}
+
+			detail::WriteLock l(_resourcesMutex);
+			if (index >= _resources.size())
+				_resources.resize(index + 1);
+			if (_resources[index] == nullptr) // Might have been created by another thread between unlock() and lock()
+				_resources[index] = std::make_shared<T>();
+			return *static_cast<T *>(_resources[index].get());
+		}
+
+		template<typename T>
+		std::decay_t<T> & setResource(T && value) {
+			auto & ret = resource<std::decay_t<T>>();
+			ret = FWD(value);
+			return ret;
+		}
+
+		template<typename T>
+		bool hasResource() const {
+			static const auto index = Component<T>::id();
+			detail::ReadLock l(_resourcesMutex);
+			return index < _resources.size() && _resources[index] != nullptr;
+		}
+
+		// Entity created by TypeHelper::getTypeEntity for a Component ID, or Entity::INVALID_ID
+		Entity::ID getTypeEntityID(size_t component) const;
+
+		template<typename T>
+		void removeResource() {
+			static const auto index = Component<T>::id();
+			std::shared_ptr<void> removed; // Destroyed after unlocking, in case T's destructor accesses resources
+			detail::WriteLock l(_resourcesMutex);
+			if (index < _resources.size())
+				removed = std::move(_resources[index]);
+		}
+
+	public:
+		CommandBuffer & getCommandBuffer(); // One per thread
+		void playbackCommands(); // Must not be called while other threads are accessing the EntityManager
+
+	public:
+		// Frees Component chunks which no live Entity uses and trims archetype storage. Returns the number of chunks freed
+		// Must not be called while other threads are accessing the EntityManager
+		size_t compact();
+		// Have `playbackCommands` call `compact` once `removedEntities` Entities have been removed since the last compaction. 0 disables it
+		void setAutoCompaction(size_t removedEntities) { _autoCompaction = removedEntities; }
+
 	public:
 		std::atomic<bool> running = true;
 
 	private:
-		struct Archetype {
+		struct ArchetypeKey {
 			Entity::Mask mask;
-			std::vector<Entity::ID> entities;
-			bool sorted = true;
+			std::vector<std::pair<size_t, size_t>> shared; // Shared Component IDs and value indices, sorted by Component ID
+
+			bool operator==(const ArchetypeKey & rhs) const { return mask == rhs.mask && shared == rhs.shared; }
+		};
+
+		struct ArchetypeKeyHash {
+			size_t operator()(const ArchetypeKey & key) const {
+				auto ret = std::hash<Entity::Mask>()(key.mask);
+				for (const auto & [component, value] : key.shared)
+					ret ^= std::hash<size_t>()(value) + 0x9e3779b9 + (ret << 6) + (ret >> 2);
+				return ret;
+			}
+		};
+
+		struct Archetype {
+			const ArchetypeKey * key = nullptr; // Key in `_archetypeIndices`
+			const Entity::Mask * mask = nullptr; // `&key->mask`, so that Entities can point to it
+			std::pmr::vector<Entity::ID> entities;
+			std::vector<std::pair<size_t, std::unique_ptr<detail::ColumnBase>>> columns; // Storage for archetype-stored Components, indexed like `entities`
+			std::vector<std::pair<size_t, void *>> shared; // Values of shared Components, as listed in `key`
+			std::vector<std::pair<size_t, void(*)(detail::GlobalCompMap &, size_t)>> sparse; // Sparse-set-stored Components, with their ComponentType::eraseSparse
+			std::vector<std::pair<size_t, size_t>> edges; // Archetype reached by attaching or detaching a Component. Protected by `_archetypesMutex`
 			mutable detail::Mutex mutex;
 
-			Archetype(Entity::Mask mask, Entity::ID firstEntity);
+			Archetype(const ArchetypeKey & key, const detail::GlobalCompMap & components);
 			Archetype() = default;
 			Archetype(Archetype &&);
-			Archetype(const Archetype &);
-
-			void add(Entity::ID id);
-			void remove(Entity::ID id);
-			void sort();
-
-			template<typename ... Comps>
-			bool matches() {
-				{
-					detail::ReadLock l(mutex);
-					if (entities.empty())
-						return false;
-				}
 
-				bool good = true;
-				putils::for_each_type<Comps...>([&](auto && type) {
-					using T = putils_wrapped_type(type);
+			size_t add(Entity::ID id, Archetype * previous, size_t previousRow); // Moves `id`'s archetype-stored Components out of `previous`, if any. Returns the new row
+			size_t addMany(const std::vector<Entity::ID> & ids); // Default-constructs archetype-stored Components. Returns the first new row
+			Entity::ID remove(size_t row); // Returns the entity moved into `row`, if any
+			void shrinkToFit();
 
-					if constexpr (kengine::is_not<T>()) {
-						using CompType = typename T::CompType;
-						const bool hasComp = mask.test(Component<CompType>::id());
-						good &= !hasComp;
-					}
-					else {
-						const bool hasComp = mask.test(Component<T>::id());
-						good &= hasComp;
-					}
-				});
+			detail::ColumnBase * getColumn(size_t component) const {
+				for (const auto & [id, column] : columns)
+					if (id == component)
+						return column.get();
+				return nullptr;
+			}
 
-				if (good && !sorted) {
-					detail::WriteLock l(mutex);
-					sort();
-				}
+			void * getShared(size_t component) const {
+				for (const auto & [id, value] : shared)
+					if (id == component)
+						return value;
+				return nullptr;
+			}
+		};
+
+		// Archetypes matching a set of included and excluded Components, kept up to date as archetypes are created
+		struct Query {
+			Entity::Mask include;
+			Entity::Mask exclude;
+			std::vector<size_t> archetypes; // Protected by `_archetypesMutex`
 
-				return good;
+			bool matches(const Entity::Mask & mask) const {
+				return mask.contains(include) && !mask.intersects(exclude);
 			}
 		};
 
@@ -137,33 +341,15 @@ namespace kengine {
 		struct ComponentCollection {
 			struct ComponentIterator {
 				using iterator_category = std::forward_iterator_tag;
-				using value_type = std::tuple<Entity, Comps & ...>;
+				using value_type = std::tuple<Entity, detail::iterated_type_t<Comps> & ...>;
 				using reference = const value_type &;
 				using pointer = const value_type *;
 				using difference_type = size_t;
 
 				ComponentIterator & operator++() {
 					++currentEntity;
-					auto & archetype = em._archetypes[currentType];
-
-					{
-						detail::ReadLock l(archetype.mutex);
-						if (currentEntity < archetype.entities.size())
-						{
-							detail::ReadLock l(em._entitiesMutex);
-							if (em._entities[archetype.entities[currentEntity]].active)
-								return *this;
-						}
-					}
-
-					currentEntity = 0;
-					{
-						detail::ReadLock l(em._archetypesMutex);
-						for (++currentType; currentType < em._archetypes.size(); ++currentType)
-							if (em._archetypes[currentType].matches<Comps...>())
-								break;
-					}
-
+					detail::ReadLock l(em._archetypesMutex);
+					skipInactive();
 					return *this;
 				}
 
@@ -171,94 +357,282 @@ namespace kengine {
 				bool operator!=(const ComponentIterator & rhs) const { return currentType < rhs.currentType || currentEntity < rhs.currentEntity; }
 
 				template<typename T>
-				static T & get(Entity & e) {
+				detail::iterated_type_t<T> & get(Entity & e, const Archetype & archetype) const {
 					if constexpr (kengine::is_not<T>()) {
 						static T ret;
 						return ret;
 					}
-					else
-						return e.get<T>();
+					else if constexpr (kengine::is_changed<T>())
+						return get<const typename T::CompType>(e, archetype);
+					else {
+						using Comp = std::remove_const_t<T>;
+						if constexpr (detail::is_archetype_stored<Comp>()) {
+							if constexpr (!std::is_const<T>())
+								Component<Comp>::markChanged(em._components, e.id);
+							static const auto component = Component<Comp>::id();
+							return static_cast<detail::Column<Comp> *>(archetype.getColumn(component))->data[currentEntity];
+						}
+						else if constexpr (detail::is_shared<Comp>()) {
+							if constexpr (!std::is_const<T>())
+								Component<Comp>::markChanged(em._components, e.id);
+							static const auto component = Component<Comp>::id();
+							return *static_cast<Comp *>(archetype.getShared(component));
+						}
+						else if constexpr (std::is_const<T>())
+							return Component<Comp>::read(em._components, e.id);
+						else
+							return Component<Comp>::get(em._components, e.id);
+					}
 				};
 
-				std::tuple<Entity, Comps &...> operator*() const {
+				// Whether `id` passes all Changed<T> filters
+				bool changed(Entity::ID id) const {
+					bool ret = true;
+					putils::for_each_type<Comps...>([&](auto && type) {
+						using T = putils_wrapped_type(type);
+						if constexpr (kengine::is_changed<T>())
+							ret = ret && Component<typename T::CompType>::getVersion(em._components, id) > changedSince;
+					});
+					return ret;
+				}
+
+				std::tuple<Entity, detail::iterated_type_t<Comps> &...> operator*() const {
 					detail::ReadLock l(em._archetypesMutex);
-					const auto & archetype = em._archetypes[currentType];
+					const auto & archetype = em._archetypes[query.archetypes[currentType]];
 
 					detail::ReadLock l2(archetype.mutex);
 					Entity e(archetype.entities[currentEntity], archetype.mask, &em);
-					return std::make_tuple(e, std::ref(get<Comps>(e))...);
+					return std::make_tuple(e, std::ref(get<Comps>(e, archetype))...);
 				}
 
-				EntityManager & em;
-				size_t currentType;
-				size_t currentEntity;
-			};
-
-			auto begin() const {
-				detail::ReadLock l(em._archetypesMutex);
+				// Moves forward until an active entity is found. Must hold a read lock on `em._archetypesMutex`
+				void skipInactive() {
+					for (; currentType < query.archetypes.size(); ++currentType, currentEntity = 0) {
+						const auto & archetype = em._archetypes[query.archetypes[currentType]];
 
-				size_t archetypeIndex = 0;
-				for (auto & archetype : em._archetypes) {
-					if (archetype.matches<Comps...>()) {
 						detail::ReadLock l(archetype.mutex);
 						detail::ReadLock l2(em._entitiesMutex);
-
-						size_t entityIndex = 0;
-						for (const auto entityID : archetype.entities) {
-							if (em._entities[entityID].active)
-								return ComponentIterator{ em, archetypeIndex, entityIndex };
-							++entityIndex;
+						for (; currentEntity < archetype.entities.size(); ++currentEntity) {
+							const auto id = archetype.entities[currentEntity];
+							if (em._entities[id].active && changed(id))
+								return;
 						}
 					}
-					++archetypeIndex;
 				}
 
-				return ComponentIterator{ em, em._archetypes.size(), 0 };
+				EntityManager & em;
+				const Query & query;
+				size_t currentType; // Index in `query.archetypes`
+				size_t currentEntity;
+				uint32_t changedSince = 0;
+			};
+
+			auto begin() const {
+				detail::ReadLock l(em._archetypesMutex);
+				ComponentIterator ret{ em, query, 0, 0, changedSince };
+				ret.skipInactive();
+				return ret;
 			}
 
 			auto end() const {
 				detail::ReadLock l(em._archetypesMutex);
-				return ComponentIterator{ em, em._archetypes.size(), 0 };
+				return ComponentIterator{ em, query, query.archetypes.size(), 0, changedSince };
 			}
 
 			EntityManager & em;
+			const Query & query;
+			uint32_t changedSince;
 		};
 
     public:
+		// `changedSince` is only used by Changed<T> filters
+		template<typename ... Comps>
+		auto getEntities(uint32_t changedSince = 0) {
+			return ComponentCollection<Comps...>{ *this, getQuery<Comps...>(), changedSince };
+		}
+
+		// Returns the current change version, and starts a new one: Components accessed mutably from now on will pass `Changed<T>` filters given the returned version
+		uint32_t advanceChangeVersion() { return _components.changeVersion++; }
+
+		// Func: void(Entity &, Comps &...)
+		// Splits matching entities into tasks of at most `grainSize` entities and waits for them to complete
+		template<typename ... Comps, typename Func>
+		void parallelForEach(Func && func, size_t grainSize = KENGINE_PARALLEL_FOR_EACH_GRAIN_SIZE) {
+			static_assert((!kengine::is_changed<Comps>() && ...), "Changed<T> filters are only supported by getEntities");
+			const auto & query = getQuery<Comps...>();
+
+			struct Range {
+				size_t type; // Index in `query.archetypes`
+				size_t begin;
+				size_t end;
+			};
+			std::vector<Range> ranges;
+			{
+				detail::ReadLock l(_archetypesMutex);
+				for (size_t type = 0; type < query.archetypes.size(); ++type) {
+					const auto & archetype = _archetypes[query.archetypes[type]];
+					detail::ReadLock l(archetype.mutex);
+					const auto size = archetype.entities.size();
+					for (size_t begin = 0; begin < size; begin += grainSize)
+						ranges.push_back({ type, begin, std::min(begin + grainSize, size) });
+				}
+			}
+
+			// Only wait for our own tasks, so that parallelForEach may be called from within another task
+			std::atomic<size_t> remaining = ranges.size();
+			for (const auto & range : ranges)
+				runTask([this, &query, &func, &remaining, range] {
+					struct Done {
+						std::atomic<size_t> & remaining;
+						~Done() { --remaining; }
+					} done{ remaining };
+
+					typename ComponentCollection<Comps...>::ComponentIterator it{ *this, query, range.type, range.begin };
+					for (; it.currentEntity < range.end; ++it.currentEntity) {
+						{
+							detail::ReadLock l(_archetypesMutex);
+							const auto & archetype = _archetypes[query.archetypes[range.type]];
+							detail::ReadLock l2(archetype.mutex);
+							if (it.currentEntity >= archetype.entities.size()) // Entities have been removed since ranges were computed
+								return;
+							detail::ReadLock l3(_entitiesMutex);
+							if (!_entities[archetype.entities[it.currentEntity]].active)
+								continue;
+						}
+
+						auto args = *it;
+						std::apply(func, args);
+					}
+				});
+
+			completeTasksUntil([&remaining] { return remaining == 0; });
+		}
+
+	private:
 		template<typename ... Comps>
-		auto getEntities() {
-			return ComponentCollection<Comps...>{ *this };
+		const Query & getQuery() {
+			static const auto masks = [] {
+				std::pair<Entity::Mask, Entity::Mask> ret; // include, exclude
+				putils::for_each_type<Comps...>([&](auto && type) {
+					using T = putils_wrapped_type(type);
+					if constexpr (kengine::is_not<T>())
+						ret.second.set(Component<typename T::CompType>::id());
+					else if constexpr (kengine::is_changed<T>())
+						ret.first.set(Component<typename T::CompType>::id());
+					else
+						ret.first.set(Component<std::remove_const_t<T>>::id());
+				});
+				return ret;
+			}();
+			return getQuery(masks.first, masks.second);
 		}
 
+		const Query & getQuery(const Entity::Mask & include, const Entity::Mask & exclude);
+
 	private:
 		Entity alloc();
+		void allocMany(size_t count, std::vector<Entity::ID> & ids);
+		void addMany(const std::vector<Entity::ID> & ids, const Entity::Mask & mask); // `ids` must not have any Components yet
+		void notifyCreated(const std::vector<Entity::ID> & ids, const Entity::Mask & mask); // Calls observers and OnEntityCreated, then activates `ids`
+		void release(Entity::ID id); // Removes `id` from its archetype and frees it, without calling any callbacks
 
     private:
 		friend class Entity;
-		void addComponent(Entity::ID id, size_t component);
-		void removeComponent(Entity::ID id, size_t component);
-		void updateHasComponent(Entity::ID id, size_t component, bool newHasComponent);
+		// These return the Entity's new mask
+		const Entity::Mask * addComponent(Entity::ID id, size_t component);
+		const Entity::Mask * removeComponent(Entity::ID id, size_t component);
+		const Entity::Mask * updateHasComponent(Entity::ID id, size_t component, bool newHasComponent);
+		// Must hold a write lock on `_archetypesMutex`. `component` is the changed Component if there is only one, used to follow archetype edges
+		const Entity::Mask * setMask(Entity::ID id, const Entity::Mask & updatedMask, size_t component = detail::INVALID);
+		const Entity::Mask * setSharedValue(Entity::ID id, size_t component, size_t value); // Attaches `component` if needed
+		// Must hold a write lock on `_archetypesMutex`
+		const Entity::Mask * moveToArchetype(Entity::ID id, size_t oldArchetype, size_t oldRow, size_t updatedArchetype);
+
+	private:
+		using Observer = std::function<void(Entity &)>;
+		using ObserverList = std::vector<Observer>;
+		struct ComponentObservers {
+			// Replaced rather than modified, so that observers can be called without holding `_observersMutex`
+			std::shared_ptr<const ObserverList> onAttach;
+			std::shared_ptr<const ObserverList> onDetach;
+		};
+		std::vector<ComponentObservers> _observers; // Indexed by Component ID
+		mutable detail::Mutex _observersMutex;
+
+		void addObserver(size_t component, bool attach, Observer && observer);
+		std::shared_ptr<const ObserverList> getObservers(size_t component, bool attach) const; // nullptr if there are none
+		void notifyAttach(Entity & e, size_t component) const;
+		void notifyDetach(Entity & e, size_t component) const; // `e` must still have `component`
+
+	private:
+		friend void * detail::getArchetypeElement(EntityManager & em, size_t entityID, size_t componentID);
+		void * getArchetypeElement(Entity::ID id, size_t component);
+		friend void * detail::getArchetypeElements(EntityManager & em, const size_t * ids, size_t count, size_t componentID, size_t & run);
+		void * getArchetypeElements(const Entity::ID * ids, size_t count, size_t component, size_t & run);
+
+	private:
+		std::vector<std::shared_ptr<void>> _resources; // Indexed by Component ID
+		mutable detail::Mutex _resourcesMutex;
+
+	private:
+		std::vector<std::vector<std::shared_ptr<void>>> _sharedValues; // Indexed by Component ID, then value index. Protected by `_archetypesMutex`
+
+		size_t addSharedValue(size_t component, std::shared_ptr<void> && value);
+		// Must hold a write lock on `_archetypesMutex`. Creates the default value if needed
+		void * findSharedValue(size_t component, size_t index);
 
 	private:
 		struct EntityMetadata {
 			bool active = false;
-			Entity::Mask mask = 0;
+			const Entity::Mask * mask = nullptr; // Owned by the Entity's archetype, nullptr if it has no Components
 			bool shouldActivateAfterInit = true;
+			size_t archetype = detail::INVALID;
+			size_t row = detail::INVALID; // Index in the archetype's entities
+			Entity::Generation generation = 0;
+			Entity::ID nextFree = detail::INVALID; // Intrusive free list, only meaningful while the ID is free
+			size_t creationIndex = 0;
 		};
 		std::vector<EntityMetadata> _entities;
+		Entity::ID _firstFree = detail::INVALID; // Protected by `_entitiesMutex`
+		size_t _nextCreationIndex = 0; // Protected by `_entitiesMutex`
 		mutable detail::Mutex _entitiesMutex;
 
 		std::vector<Archetype> _archetypes;
-		mutable detail::Mutex _archetypesMutex;
+		std::unordered_map<ArchetypeKey, size_t, ArchetypeKeyHash> _archetypeIndices; // Node-based, so Archetype::key remains valid
+
+		struct QueryKeyHash {
+			size_t operator()(const std::pair<Entity::Mask, Entity::Mask> & key) const {
+				const auto include = std::hash<Entity::Mask>()(key.first);
+				return include ^ (std::hash<Entity::Mask>()(key.second) + 0x9e3779b9 + (include << 6) + (include >> 2));
+			}
+		};
+		std::unordered_map<std::pair<Entity::Mask, Entity::Mask>, Query, QueryKeyHash> _queries; // Node-based, so references remain valid
+
+		mutable detail::Mutex _archetypesMutex; // Also protects `_queries`
 
-		std::vector<Entity::ID> _toReuse;
-		bool _toReuseSorted = true;
-		mutable detail::Mutex _toReuseMutex;
+		// Must hold a write lock on `_archetypesMutex`
+		size_t getArchetypeIndex(const ArchetypeKey & key);
+		size_t getNeighborArchetypeIndex(size_t archetype, size_t component, const Entity::Mask & neighborMask);
+		// Shared Components keep their value from `previousArchetype`, or get their default one
+		ArchetypeKey makeKey(const Entity::Mask & mask, size_t previousArchetype) const;
+
+		static inline std::atomic<size_t> s_nextUid = 0;
+		const size_t _uid; // Unlike `this`, never reused by another EntityManager
+		std::vector<std::unique_ptr<CommandBuffer>> _commandBuffers;
+		detail::Mutex _commandBuffersMutex;
+
+		std::atomic<size_t> _autoCompaction = 0;
+		std::atomic<size_t> _removedSinceCompaction = 0;
 
 	private:
 		mutable detail::GlobalCompMap _components; // Mutable to lock mutex
 
-	public: // Reserved to PluginHelper::initPlugin
+	public: // Reserved to helpers which must target this EntityManager's storage whichever is current (e.g. PluginHelper::initPlugin)
 		detail::GlobalCompMap & _getComponentMap() { return _components; }
 	};
 }
+
+// Defined here rather than in Entity.hpp, as it needs the complete EntityManager whichever header was included first
+inline kengine::detail::GlobalCompMap & kengine::Entity::getComponents() const {
+	return manager != nullptr ? manager->_components : detail::getComponents();
+}
@@ -0,0 +1,124 @@
+#include <random>
+#include "WorkStealingPool.hpp"
+
+namespace kengine {
+	namespace {
+		thread_local const WorkStealingPool * t_pool = nullptr; // Pool the current thread is a worker of
+		thread_local size_t t_queue = 0;
+	}
+
+	WorkStealingPool::WorkStealingPool(size_t threads) {
+		for (size_t i = 0; i < threads; ++i)
+			_queues.push_back(std::make_unique<Queue>());
+		if (threads == 0)
+			_queues.push_back(std::make_unique<Queue>());
+
+		for (size_t i = 0; i < threads; ++i)
+			_threads.emplace_back([this, i] { workerLoop(i); });
+	}
+
+	WorkStealingPool::~WorkStealingPool() {
+		{
+			std::lock_guard<std::mutex> l(_sleepMutex);
+			_stop = true;
+		}
+		_wake.notify_all();
+
+		for (auto & t : _threads)
+			t.join();
+	}
+
+	void WorkStealingPool::completeTasks() {
+		completeTasksUntil([this] { return _pending == 0; });
+	}
+
+	size_t WorkStealingPool::getQueue() {
+		return t_pool == this ? t_queue : _nextQueue++ % _queues.size();
+	}
+
+	void WorkStealingPool::push(Task && task) {
+		const auto queue = getQueue();
+
+		++_pending;
+		++_queued; // Before pushing, so that thieves can't decrement it first
+		{
+			auto & q = *_queues[queue];
+			std::lock_guard<std::mutex> l(q.mutex);
+			q.tasks.push_back(std::move(task));
+		}
+
+		// Sleepers increment `_sleeping` before re-checking `_queued`, so either they see this task or we see them
+		if (_sleeping > 0) {
+			{ std::lock_guard<std::mutex> l(_sleepMutex); }
+			_wake.notify_one();
+		}
+	}
+
+	bool WorkStealingPool::popOrSteal(size_t queue, Task & task) {
+		{ // Own tasks, newest first as they're most likely to be hot in cache
+			auto & q = *_queues[queue];
+			std::lock_guard<std::mutex> l(q.mutex);
+			if (!q.tasks.empty()) {
+				task = std::move(q.tasks.back());
+				q.tasks.pop_back();
+				--_queued;
+				return true;
+			}
+		}
+
+		if (_queued == 0)
+			return false;
+
+		// Steal the oldest task from a random victim
+		static thread_local std::minstd_rand rng{ std::random_device{}() };
+		const auto count = _queues.size();
+		const auto start = rng() % count;
+		for (size_t i = 0; i < count; ++i) {
+			const auto victim = (start + i) % count;
+			if (victim == queue)
+				continue;
+
+			auto & q = *_queues[victim];
+			std::lock_guard<std::mutex> l(q.mutex);
+			if (!q.tasks.empty()) {
+				task = std::move(q.tasks.front());
+				q.tasks.pop_front();
+				--_queued;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void WorkStealingPool::run(Task & task) {
+		task();
+		task = nullptr;
+		--_pending;
+		// Waiters increment `_waiting` before re-checking their condition, so either they see this completion or we see them
+		if (_waiting > 0) {
+			{ std::lock_guard<std::mutex> l(_sleepMutex); }
+			_wake.notify_all();
+		}
+	}
+
+	void WorkStealingPool::workerLoop(size_t index) {
+		t_pool = this;
+		t_queue = index;
+
+		Task task;
+		while (true) {
+			if (popOrSteal(index, task)) {
+				run(task);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> l(_sleepMutex);
+			++_sleeping;
+			_wake.wait(l, [this] { return _stop || _queued > 0; });
+			--_sleeping;
+			if (_stop && _queued == 0)
+				return;
+		}
+	}
+}
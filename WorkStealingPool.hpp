@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+namespace kengine {
+	// Thread pool with one task deque per worker. Workers pop their own tasks LIFO and steal from random victims FIFO,
+	// so that many small tasks don't all contend on a single queue
+	class WorkStealingPool {
+	public:
+		WorkStealingPool(size_t threads = std::thread::hardware_concurrency());
+		~WorkStealingPool();
+
+		WorkStealingPool(const WorkStealingPool &) = delete;
+		WorkStealingPool & operator=(const WorkStealingPool &) = delete;
+
+	public:
+		template<typename F>
+		auto runTask(F && f) {
+			using Ret = decltype(f());
+			auto task = std::make_shared<std::packaged_task<Ret()>>(std::forward<F>(f));
+			auto ret = task->get_future();
+			push([task] { (*task)(); });
+			return ret;
+		}
+
+		// Runs tasks on the calling thread until all tasks (including those spawned by other tasks) have completed
+		void completeTasks();
+
+		// Runs tasks on the calling thread until `done()` returns true. `done` should read state set by tasks through seq_cst atomics,
+		// and may safely be used from within a task (e.g. to wait for a group of sub-tasks)
+		template<typename Pred>
+		void completeTasksUntil(Pred && done) {
+			const auto queue = getQueue();
+
+			Task task;
+			while (!done()) {
+				if (popOrSteal(queue, task)) {
+					run(task);
+					continue;
+				}
+
+				// Remaining tasks are running on other threads: sleep until one of them completes or spawns new tasks
+				std::unique_lock<std::mutex> l(_sleepMutex);
+				++_sleeping;
+				++_waiting;
+				_wake.wait(l, [&] { return done() || _queued > 0; });
+				--_waiting;
+				--_sleeping;
+			}
+		}
+
+		size_t getThreadCount() const { return _threads.size(); }
+
+	private:
+		using Task = std::function<void()>;
+
+		struct Queue {
+			std::deque<Task> tasks;
+			std::mutex mutex;
+		};
+
+		size_t getQueue();
+		void push(Task && task);
+		bool popOrSteal(size_t queue, Task & task);
+		void run(Task & task);
+		void workerLoop(size_t index);
+
+	private:
+		std::vector<std::unique_ptr<Queue>> _queues; // One per worker, plus a last one for external threads when there are no workers
+		std::vector<std::thread> _threads;
+
+		std::atomic<size_t> _queued = 0; // Tasks waiting in a queue
+		std::atomic<size_t> _pending = 0; // Tasks queued or running
+		std::atomic<size_t> _nextQueue = 0; // Round-robin for tasks pushed from external threads
+
+		std::mutex _sleepMutex;
+		std::condition_variable _wake;
+		std::atomic<size_t> _sleeping = 0;
+		std::atomic<size_t> _waiting = 0; // Threads sleeping in `completeTasksUntil`
+		bool _stop = false; // Protected by `_sleepMutex`
+	};
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace kengine::benchmarks {
+	// Calls `setup` then `f` `runs` times, and returns the median time spent in `f`, in milliseconds
+	template<typename Setup, typename F>
+	double measure(size_t runs, Setup && setup, F && f) {
+		std::vector<double> times;
+		times.reserve(runs);
+		for (size_t i = 0; i < runs; ++i) {
+			setup();
+			const auto start = std::chrono::steady_clock::now();
+			f();
+			const auto end = std::chrono::steady_clock::now();
+			times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		std::sort(times.begin(), times.end());
+		return times[times.size() / 2];
+	}
+
+	template<typename F>
+	double measure(size_t runs, F && f) {
+		return measure(runs, [] {}, f);
+	}
+
+	inline void report(const char * name, double milliseconds) {
+		std::printf("%-48s %10.3f ms\n", name, milliseconds);
+	}
+}
@@ -0,0 +1,40 @@
+#include <memory>
+
+#include "Benchmark.hpp"
+#include "EntityManager.hpp"
+
+#include "data/TransformComponent.hpp"
+#include "data/PhysicsComponent.hpp"
+#include "data/KinematicComponent.hpp"
+
+// Compares creating Entities one at a time with createEntity against creating them in bulk with createEntities
+
+namespace {
+	constexpr size_t Runs = 20;
+	constexpr size_t Entities = 50000;
+}
+
+int main() {
+	std::printf("%zu entities, median of %zu runs\n", Entities, Runs);
+
+	std::unique_ptr<kengine::EntityManager> em;
+	const auto reset = [&] {
+		em = nullptr;
+		em = std::make_unique<kengine::EntityManager>();
+	};
+
+	kengine::benchmarks::report("createEntity", kengine::benchmarks::measure(Runs, reset, [&] {
+		for (size_t i = 0; i < Entities; ++i)
+			em->createEntity([](kengine::Entity & e) {
+				e += kengine::TransformComponent{};
+				e += kengine::PhysicsComponent{};
+				e += kengine::KinematicComponent{};
+			});
+	}));
+
+	kengine::benchmarks::report("createEntities", kengine::benchmarks::measure(Runs, reset, [&] {
+		em->createEntities<kengine::TransformComponent, kengine::PhysicsComponent, kengine::KinematicComponent>(Entities,
+			[](kengine::Entity & e, kengine::TransformComponent & transform, kengine::PhysicsComponent & physics, kengine::KinematicComponent & kinematic) {}
+		);
+	}));
+}
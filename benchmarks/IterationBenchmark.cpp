@@ -0,0 +1,46 @@
+#include "Benchmark.hpp"
+#include "EntityManager.hpp"
+
+#include "data/TransformComponent.hpp"
+#include "data/PhysicsComponent.hpp"
+
+// Measures iteration over Entities, which takes the EntityManager's locks at every step unless KENGINE_SINGLE_THREADED is defined
+
+namespace {
+	constexpr size_t Runs = 20;
+	constexpr size_t Entities = 200000;
+}
+
+int main() {
+#ifdef KENGINE_SINGLE_THREADED
+	std::printf("KENGINE_SINGLE_THREADED, %zu entities, median of %zu runs\n", Entities, Runs);
+#else
+	std::printf("%zu entities, median of %zu runs\n", Entities, Runs);
+#endif
+
+	kengine::EntityManager em;
+	em.createEntities<kengine::TransformComponent, kengine::PhysicsComponent>(Entities, [](kengine::Entity & e, kengine::TransformComponent & transform, kengine::PhysicsComponent & physics) {
+		physics.movement = { 1.f, 0.f, 1.f };
+	});
+
+	const auto move = [](kengine::Entity & e, kengine::TransformComponent & transform, kengine::PhysicsComponent & physics) {
+		transform.boundingBox.position += physics.movement * physics.speed * .016f;
+	};
+
+	kengine::benchmarks::report("getEntities", kengine::benchmarks::measure(Runs, [&] {
+		for (auto [e, transform, physics] : em.getEntities<kengine::TransformComponent, kengine::PhysicsComponent>())
+			move(e, transform, physics);
+	}));
+
+	kengine::benchmarks::report("getEntities (const)", kengine::benchmarks::measure(Runs, [&] {
+		float sum = 0.f;
+		for (const auto & [e, transform, physics] : em.getEntities<const kengine::TransformComponent, const kengine::PhysicsComponent>())
+			sum += transform.boundingBox.position.x;
+		volatile auto result = sum; // Keeps the loop from being optimized out
+		(void)result;
+	}));
+
+	kengine::benchmarks::report("parallelForEach", kengine::benchmarks::measure(Runs, [&] {
+		em.parallelForEach<kengine::TransformComponent, kengine::PhysicsComponent>(move);
+	}));
+}
@@ -0,0 +1,68 @@
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+#include "Benchmark.hpp"
+#include "EntityManager.hpp"
+
+#include "data/TransformComponent.hpp"
+#include "data/PhysicsComponent.hpp"
+
+#include "helpers/RegisterComponentBinarySerializer.hpp"
+#include "helpers/SnapshotHelper.hpp"
+
+// Measures saving and loading snapshots, and compares loading a file read into a buffer with loadFromFile's memory mapping
+
+namespace {
+	constexpr size_t Runs = 10;
+	constexpr size_t Entities = 200000;
+
+	void registerTypes(kengine::EntityManager & em) {
+		kengine::registerComponentBinarySerializers<kengine::TransformComponent, kengine::PhysicsComponent>(em);
+	}
+}
+
+int main() {
+	std::printf("%zu entities, median of %zu runs\n", Entities, Runs);
+	const auto file = (std::filesystem::temp_directory_path() / "kengine_snapshot_benchmark.bin").string();
+
+	{
+		kengine::EntityManager em;
+		registerTypes(em);
+		em.createEntities<kengine::TransformComponent, kengine::PhysicsComponent>(Entities, [](kengine::Entity & e, kengine::TransformComponent & transform, kengine::PhysicsComponent & physics) {
+			transform.boundingBox.position.x = (float)e.id;
+			physics.speed = (float)e.id;
+		});
+
+		std::vector<char> buffer;
+		kengine::benchmarks::report("save", kengine::benchmarks::measure(Runs, [&] { buffer.clear(); }, [&] {
+			kengine::SnapshotHelper::save(em, buffer);
+		}));
+
+		if (!kengine::SnapshotHelper::saveToFile(em, file.c_str())) {
+			std::printf("Couldn't write %s\n", file.c_str());
+			return 1;
+		}
+	}
+
+	std::unique_ptr<kengine::EntityManager> em;
+	const auto reset = [&] {
+		em = nullptr;
+		em = std::make_unique<kengine::EntityManager>();
+		registerTypes(*em);
+	};
+
+	kengine::benchmarks::report("load (file read into a buffer)", kengine::benchmarks::measure(Runs, reset, [&] {
+		std::ifstream f(file, std::ios::binary);
+		std::vector<char> buffer(std::filesystem::file_size(file));
+		f.read(buffer.data(), buffer.size());
+		kengine::SnapshotHelper::load(*em, buffer.data(), buffer.size());
+	}));
+
+	kengine::benchmarks::report("loadFromFile (memory-mapped)", kengine::benchmarks::measure(Runs, reset, [&] {
+		kengine::SnapshotHelper::loadFromFile(*em, file.c_str());
+	}));
+
+	em = nullptr;
+	std::filesystem::remove(file);
+}
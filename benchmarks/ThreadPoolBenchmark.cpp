@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.hpp"
+#include "WorkStealingPool.hpp"
+#include "ThreadPool.hpp"
+
+#include "data/TransformComponent.hpp"
+#include "data/PhysicsComponent.hpp"
+
+#ifndef KENGINE_PARALLEL_FOR_EACH_GRAIN_SIZE
+# define KENGINE_PARALLEL_FOR_EACH_GRAIN_SIZE 64
+#endif
+
+// Compares putils::ThreadPool (a single locked queue) with kengine::WorkStealingPool on the workloads the engine
+// actually parallelizes: KinematicSystem's transform integration and AssimpSystem's skeleton animation.
+// Both are split into tasks of KENGINE_PARALLEL_FOR_EACH_GRAIN_SIZE entities, like EntityManager::parallelForEach does
+
+namespace {
+	constexpr size_t Runs = 20;
+	constexpr size_t KinematicEntities = 200000;
+	constexpr size_t AnimatedEntities = 5000;
+	constexpr size_t Bones = 32;
+	constexpr size_t Keyframes = 16;
+
+	struct Keyframe {
+		float position[3];
+		float rotation[4]; // Quaternion
+	};
+
+	struct Skeleton {
+		float animationTime = 0.f;
+		float matrices[Bones][16];
+	};
+
+	struct World {
+		std::vector<kengine::TransformComponent> transforms{ KinematicEntities };
+		std::vector<kengine::PhysicsComponent> physics{ KinematicEntities };
+		std::vector<Keyframe> keyframes; // Bones * Keyframes, shared by all animated Entities like a loaded model's animation
+		std::vector<Skeleton> skeletons{ AnimatedEntities };
+
+		World() {
+			for (size_t i = 0; i < KinematicEntities; ++i) {
+				physics[i].movement = { 1.f, 0.f, (float)(i % 7) };
+				physics[i].yaw = .1f;
+			}
+
+			keyframes.resize(Bones * Keyframes);
+			for (size_t i = 0; i < keyframes.size(); ++i)
+				keyframes[i] = { { (float)i, 1.f, 2.f }, { 0.f, std::sin((float)i), 0.f, std::cos((float)i) } };
+
+			for (size_t i = 0; i < AnimatedEntities; ++i)
+				skeletons[i].animationTime = (float)(i % Keyframes);
+		}
+	};
+
+	void integrate(World & world, size_t begin, size_t end, float deltaTime) {
+		for (size_t i = begin; i < end; ++i) {
+			auto & transform = world.transforms[i];
+			const auto & physics = world.physics[i];
+			transform.boundingBox.position += physics.movement * physics.speed * deltaTime;
+			transform.yaw = std::remainder(transform.yaw + physics.yaw * physics.speed * deltaTime, 6.2831853f);
+		}
+	}
+
+	void animate(World & world, size_t begin, size_t end, float deltaTime) {
+		for (size_t i = begin; i < end; ++i) {
+			auto & skeleton = world.skeletons[i];
+			skeleton.animationTime = std::fmod(skeleton.animationTime + deltaTime, (float)(Keyframes - 1));
+			const auto frame = (size_t)skeleton.animationTime;
+			const auto t = skeleton.animationTime - (float)frame;
+
+			for (size_t bone = 0; bone < Bones; ++bone) {
+				const auto & a = world.keyframes[bone * Keyframes + frame];
+				const auto & b = world.keyframes[bone * Keyframes + frame + 1];
+
+				float q[4];
+				float length = 0.f;
+				for (size_t j = 0; j < 4; ++j) {
+					q[j] = a.rotation[j] + (b.rotation[j] - a.rotation[j]) * t;
+					length += q[j] * q[j];
+				}
+				length = std::sqrt(length);
+				for (auto & f : q)
+					f /= length;
+
+				auto & m = skeleton.matrices[bone];
+				const auto x = q[0], y = q[1], z = q[2], w = q[3];
+				m[0] = 1 - 2 * (y * y + z * z); m[1] = 2 * (x * y + z * w); m[2] = 2 * (x * z - y * w); m[3] = 0;
+				m[4] = 2 * (x * y - z * w); m[5] = 1 - 2 * (x * x + z * z); m[6] = 2 * (y * z + x * w); m[7] = 0;
+				m[8] = 2 * (x * z + y * w); m[9] = 2 * (y * z - x * w); m[10] = 1 - 2 * (x * x + y * y); m[11] = 0;
+				for (size_t j = 0; j < 3; ++j)
+					m[12 + j] = a.position[j] + (b.position[j] - a.position[j]) * t;
+				m[15] = 1;
+			}
+		}
+	}
+
+	template<typename Pool, typename Func>
+	void parallelFor(Pool & pool, size_t count, Func && func) {
+		for (size_t begin = 0; begin < count; begin += KENGINE_PARALLEL_FOR_EACH_GRAIN_SIZE) {
+			const auto end = std::min(begin + KENGINE_PARALLEL_FOR_EACH_GRAIN_SIZE, count);
+			pool.runTask([&func, begin, end] { func(begin, end); });
+		}
+		pool.completeTasks();
+	}
+
+	template<typename Pool>
+	void run(const char * poolName, size_t threads) {
+		World world;
+		Pool pool(threads);
+
+		char name[128];
+		std::snprintf(name, sizeof(name), "%s: kinematic", poolName);
+		kengine::benchmarks::report(name, kengine::benchmarks::measure(Runs, [&] {
+			parallelFor(pool, KinematicEntities, [&](size_t begin, size_t end) { integrate(world, begin, end, .016f); });
+		}));
+
+		std::snprintf(name, sizeof(name), "%s: animation", poolName);
+		kengine::benchmarks::report(name, kengine::benchmarks::measure(Runs, [&] {
+			parallelFor(pool, AnimatedEntities, [&](size_t begin, size_t end) { animate(world, begin, end, .016f); });
+		}));
+	}
+}
+
+int main(int ac, const char ** av) {
+	const size_t threads = ac > 1 ? std::stoul(av[1]) : std::thread::hardware_concurrency();
+	std::printf("%zu threads, median of %zu runs\n", threads, Runs);
+	run<putils::ThreadPool>("putils::ThreadPool", threads);
+	run<kengine::WorkStealingPool>("kengine::WorkStealingPool", threads);
+}
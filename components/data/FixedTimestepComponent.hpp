@@ -0,0 +1,9 @@
+#pragma once
+
+#include "reflection.hpp"
+
+namespace kengine {
+	struct FixedTimestepComponent {
+		putils_reflection_class_name(FixedTimestepComponent);
+	};
+}
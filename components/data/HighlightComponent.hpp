@@ -2,6 +2,7 @@
 
 #include "Point.hpp"
 #include "Color.hpp"
+#include "Component.hpp"
 
 namespace kengine {
 	struct HighlightComponent {
@@ -14,4 +15,10 @@ namespace kengine {
 			putils_reflection_attribute(&HighlightComponent::intensity)
 		);
 	};
+
+	// Only a handful of Entities are highlighted at any time
+	template<>
+	struct component_storage<HighlightComponent> {
+		static constexpr auto value = ComponentStorage::SparseSet;
+	};
 }
\ No newline at end of file
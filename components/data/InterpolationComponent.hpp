@@ -0,0 +1,16 @@
+#pragma once
+
+#include "reflection.hpp"
+
+namespace kengine {
+	struct InterpolationComponent {
+		float alpha = 0.f; // Fraction of a step elapsed since the last simulation step, in [0, 1)
+		float step = 0.f; // Duration of a simulation step, in seconds
+
+		putils_reflection_class_name(InterpolationComponent);
+		putils_reflection_attributes(
+			putils_reflection_attribute(&InterpolationComponent::alpha),
+			putils_reflection_attribute(&InterpolationComponent::step)
+		);
+	};
+}
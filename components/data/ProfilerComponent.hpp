@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef KENGINE_PROFILER_SAMPLES
+# define KENGINE_PROFILER_SAMPLES 128
+#endif
+
+#include <algorithm>
+#include "reflection.hpp"
+
+namespace kengine {
+	struct ProfilerComponent {
+		struct Sample {
+			double start = 0.; // Seconds since the main loop started. Double, so that samples stay microsecond-accurate after hours of running
+			float duration = 0.f; // Seconds
+		};
+
+		Sample samples[KENGINE_PROFILER_SAMPLES]; // Ring buffer of the latest calls
+		size_t callCount = 0;
+		double totalTime = 0.; // Double, so that short calls are still counted once the total grows large
+
+		void record(double start, float duration) {
+			samples[callCount % KENGINE_PROFILER_SAMPLES] = { start, duration };
+			++callCount;
+			totalTime += (double)duration;
+		}
+
+		size_t sampleCount() const { return std::min(callCount, (size_t)KENGINE_PROFILER_SAMPLES); }
+
+		const Sample & last() const { return samples[(callCount + KENGINE_PROFILER_SAMPLES - 1) % KENGINE_PROFILER_SAMPLES]; }
+
+		// p in [0, 1], over the latest samples
+		float percentile(float p) const {
+			const auto count = sampleCount();
+			if (count == 0)
+				return 0.f;
+
+			float durations[KENGINE_PROFILER_SAMPLES];
+			for (size_t i = 0; i < count; ++i)
+				durations[i] = samples[i].duration;
+
+			const auto nth = std::min((size_t)(p * count), count - 1);
+			std::nth_element(durations, durations + nth, durations + count);
+			return durations[nth];
+		}
+
+		putils_reflection_class_name(ProfilerComponent);
+		putils_reflection_attributes(
+			putils_reflection_attribute(&ProfilerComponent::callCount),
+			putils_reflection_attribute(&ProfilerComponent::totalTime)
+		);
+	};
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Entity.hpp"
+#include "Component.hpp"
+
+namespace kengine {
+	struct SystemAccessComponent {
+		Entity::Mask reads; // Indexed by Component ID
+		Entity::Mask writes;
+
+		template<typename ... Comps>
+		SystemAccessComponent & read() {
+			putils::for_each_type<Comps...>([this](auto && t) {
+				using T = putils_wrapped_type(t);
+				reads.set(Component<T>::id());
+			});
+			return *this;
+		}
+
+		template<typename ... Comps>
+		SystemAccessComponent & write() {
+			putils::for_each_type<Comps...>([this](auto && t) {
+				using T = putils_wrapped_type(t);
+				writes.set(Component<T>::id());
+			});
+			return *this;
+		}
+
+		bool conflictsWith(const SystemAccessComponent & other) const {
+			return writes.intersects(other.reads) || writes.intersects(other.writes) || other.writes.intersects(reads);
+		}
+
+		putils_reflection_class_name(SystemAccessComponent);
+		putils_reflection_attributes(
+			putils_reflection_attribute(&SystemAccessComponent::reads),
+			putils_reflection_attribute(&SystemAccessComponent::writes)
+		);
+	};
+}
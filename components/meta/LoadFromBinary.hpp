@@ -0,0 +1,15 @@
+#pragma once
+
+#include "BaseFunction.hpp"
+
+namespace kengine {
+	class EntityManager;
+
+	namespace meta {
+		struct LoadFromBinary : functions::BaseFunction<
+			bool(EntityManager & em, const char * data, size_t size, const size_t * ids, size_t count)
+		> {
+			putils_reflection_class_name(LoadFromBinary);
+		};
+	}
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+#include "BaseFunction.hpp"
+
+namespace kengine {
+	class EntityManager;
+
+	namespace meta {
+		struct SaveToBinary : functions::BaseFunction<
+			void(EntityManager & em, const size_t * ids, size_t count, std::vector<char> & out)
+		> {
+			putils_reflection_class_name(SaveToBinary);
+		};
+	}
+}
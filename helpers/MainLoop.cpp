@@ -1,21 +1,171 @@
 #include <chrono>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
 
 #include "MainLoop.hpp"
 #include "EntityManager.hpp"
 #include "functions/Execute.hpp"
+#include "data/SystemAccessComponent.hpp"
+#include "data/FixedTimestepComponent.hpp"
+#include "data/InterpolationComponent.hpp"
+#include "data/ProfilerComponent.hpp"
 #include "Timer.hpp"
 
 namespace kengine::MainLoop {
+	namespace {
+		struct System {
+			Entity::ID id;
+			size_t creationIndex;
+			const functions::Execute * execute;
+			const SystemAccessComponent * access; // nullptr if the system didn't declare its accesses
+			ProfilerComponent * profiler;
+			size_t wave;
+		};
+
+		bool conflict(const System & lhs, const System & rhs) {
+			if (lhs.access == nullptr || rhs.access == nullptr)
+				return true;
+			return lhs.access->conflictsWith(*rhs.access);
+		}
+
+		enum class Systems {
+			All,
+			FixedTimestep, // Only those with a FixedTimestepComponent
+			Variable // Only those without a FixedTimestepComponent
+		};
+
+		struct State {
+			std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now(); // Profiling timestamps are relative to this
+			std::vector<System> systems;
+			std::vector<const System *> wave;
+			std::vector<Entity::ID> unprofiled;
+		};
+	}
+
+	static void executeSystem(const System & system, float deltaTime, const State & state) {
+		const auto start = std::chrono::steady_clock::now();
+		(*system.execute)(deltaTime);
+		const auto end = std::chrono::steady_clock::now();
+
+		// Each system is only run by one thread at a time, so its profiler needs no synchronization
+		system.profiler->record(
+			std::chrono::duration<double, std::ratio<1>>(start - state.origin).count(),
+			std::chrono::duration<float, std::ratio<1>>(end - start).count()
+		);
+	}
+
+	static void executeSystems(EntityManager & em, float deltaTime, Systems which, State & state) {
+		auto & systems = state.systems;
+		auto & wave = state.wave;
+
+		// Systems are ordered by creation, so that declaring accesses (which moves a system to another archetype) doesn't reorder it
+		systems.clear();
+		state.unprofiled.clear();
+		for (auto && [e, execute] : em.getEntities<functions::Execute>()) {
+			if (which != Systems::All && e.has<FixedTimestepComponent>() != (which == Systems::FixedTimestep))
+				continue;
+			const auto access = e.has<SystemAccessComponent>() ? &e.get<SystemAccessComponent>() : nullptr;
+			ProfilerComponent * profiler = nullptr;
+			if (e.has<ProfilerComponent>())
+				profiler = &e.get<ProfilerComponent>();
+			else
+				state.unprofiled.push_back(e.id);
+			systems.push_back({ e.id, em.getCreationIndex(e.id), &execute, access, profiler, 0 });
+		}
+
+		// Attached once iteration is over, as it moves systems to another archetype
+		for (const auto id : state.unprofiled) {
+			auto & profiler = em.getEntity(id).attach<ProfilerComponent>();
+			for (auto & system : systems)
+				if (system.id == id)
+					system.profiler = &profiler;
+		}
+		std::sort(systems.begin(), systems.end(), [](const System & lhs, const System & rhs) { return lhs.creationIndex < rhs.creationIndex; });
+
+		// Each system runs in the wave following the last earlier system it conflicts with,
+		// which preserves the order of conflicting systems and makes undeclared systems act as barriers
+		size_t waveCount = 0;
+		for (size_t i = 0; i < systems.size(); ++i) {
+			auto & system = systems[i];
+			for (size_t j = 0; j < i; ++j)
+				if (systems[j].wave >= system.wave && conflict(systems[j], system))
+					system.wave = systems[j].wave + 1;
+			waveCount = std::max(waveCount, system.wave + 1);
+		}
+
+		for (size_t i = 0; i < waveCount; ++i) {
+			wave.clear();
+			for (const auto & system : systems)
+				if (system.wave == i)
+					wave.push_back(&system);
+
+			if (wave.size() == 1) // Includes all undeclared systems, which are run on the main thread
+				executeSystem(*wave[0], deltaTime, state);
+			else {
+				std::atomic<size_t> remaining = wave.size();
+				for (const auto system : wave)
+					em.runTask([system, deltaTime, &state, &remaining] {
+						struct Done {
+							std::atomic<size_t> & remaining;
+							~Done() { --remaining; }
+						} done{ remaining };
+						executeSystem(*system, deltaTime, state);
+					});
+				em.completeTasksUntil([&remaining] { return remaining == 0; });
+			}
+
+			// Sync point: no system is running
+			em.playbackCommands();
+		}
+	}
+
 	void run(EntityManager & em) {
-		auto start = std::chrono::system_clock::now();
-		auto end = std::chrono::system_clock::now();
+		em.makeCurrent();
+		State state;
+
+		auto start = std::chrono::steady_clock::now();
+		auto end = std::chrono::steady_clock::now();
 		while (em.running) {
 			const float deltaTime = std::chrono::duration<float, std::ratio<1>>(end - start).count();
 
-			start = std::chrono::system_clock::now();
-			for (const auto & [e, func] : em.getEntities<functions::Execute>())
-				func(deltaTime);
-			end = std::chrono::system_clock::now();
+			start = std::chrono::steady_clock::now();
+			executeSystems(em, deltaTime, Systems::All, state);
+			end = std::chrono::steady_clock::now();
 		}
 	}
-}
\ No newline at end of file
+
+	void runFixed(EntityManager & em, float step, size_t maxSubsteps) {
+		em.makeCurrent();
+		State state;
+
+		const auto interpolationID = em.createEntity([step](Entity & e) {
+			e += InterpolationComponent{ 0.f, step };
+		}).id;
+
+		float accumulator = 0.f;
+		auto last = std::chrono::steady_clock::now();
+		while (em.running) {
+			const auto now = std::chrono::steady_clock::now();
+			const float deltaTime = std::chrono::duration<float, std::ratio<1>>(now - last).count();
+			last = now;
+
+			accumulator += deltaTime;
+			size_t substeps = 0;
+			while (accumulator >= step && substeps < maxSubsteps) {
+				executeSystems(em, step, Systems::FixedTimestep, state);
+				accumulator -= step;
+				++substeps;
+			}
+			// Drop the time we couldn't catch up on instead of spiraling into ever longer frames
+			if (accumulator >= step)
+				accumulator = std::fmod(accumulator, step);
+
+			em.getEntity(interpolationID).get<InterpolationComponent>().alpha = accumulator / step;
+			executeSystems(em, deltaTime, Systems::Variable, state);
+		}
+
+		em.removeEntity(interpolationID);
+	}
+}
@@ -4,4 +4,5 @@ namespace kengine { class EntityManager; }
 
 namespace kengine::MainLoop {
 	void run(EntityManager & em);
+	void runFixed(EntityManager & em, float step = 1.f / 60.f, size_t maxSubsteps = 5);
 }
\ No newline at end of file
@@ -3,6 +3,9 @@
 
 namespace kengine::PluginHelper {
     void initPlugin(EntityManager & em) {
-        detail::components = &em._getComponentMap();
+        auto & components = em._getComponentMap();
+        detail::registry = components.registry; // Share Component IDs with the host
+        detail::defaultComponents = &components;
+        detail::currentComponents = &components;
     }
 }
\ No newline at end of file
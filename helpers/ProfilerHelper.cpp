@@ -0,0 +1,93 @@
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+
+#include "ProfilerHelper.hpp"
+#include "EntityManager.hpp"
+#include "data/ProfilerComponent.hpp"
+#include "data/NameComponent.hpp"
+
+namespace kengine::ProfilerHelper {
+	putils::string<64> getName(const Entity & e) {
+		if (e.has<NameComponent>())
+			return e.get<NameComponent>().name.c_str();
+		return putils::string<64>("System %zu", e.id);
+	}
+
+	// Writes `s` as a quoted JSON string
+	static void writeJSONString(std::ostream & f, const char * s) {
+		f << '"';
+		for (; *s != 0; ++s) {
+			const auto c = *s;
+			if (c == '"' || c == '\\')
+				f << '\\' << c;
+			else if ((unsigned char)c < 0x20) { // Control characters must be escaped
+				char escaped[7];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				f << escaped;
+			}
+			else
+				f << c;
+		}
+		f << '"';
+	}
+
+	// Writes `s` as a quoted CSV field (RFC 4180), so that names may hold commas, quotes or line breaks
+	static void writeCSVString(std::ostream & f, const char * s) {
+		f << '"';
+		for (; *s != 0; ++s) {
+			if (*s == '"')
+				f << '"';
+			f << *s;
+		}
+		f << '"';
+	}
+
+	bool dumpCSV(EntityManager & em, const char * file) {
+		std::ofstream f(file);
+		if (!f)
+			return false;
+
+		f << "system,calls,total (ms),last (ms),p50 (ms),p95 (ms),p99 (ms),max (ms)\n";
+		for (const auto & [e, profiler] : em.getEntities<const ProfilerComponent>()) {
+			writeCSVString(f, getName(e).c_str());
+			f << ','
+				<< profiler.callCount << ','
+				<< profiler.totalTime * 1000. << ','
+				<< profiler.last().duration * 1000.f << ','
+				<< profiler.percentile(.5f) * 1000.f << ','
+				<< profiler.percentile(.95f) * 1000.f << ','
+				<< profiler.percentile(.99f) * 1000.f << ','
+				<< profiler.percentile(1.f) * 1000.f << '\n';
+		}
+		return true;
+	}
+
+	// https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+	bool dumpChromeTrace(EntityManager & em, const char * file) {
+		std::ofstream f(file);
+		if (!f)
+			return false;
+
+		f << std::fixed << std::setprecision(3); // Nanoseconds, without switching to scientific notation once timestamps grow large
+		f << "{\"traceEvents\":[";
+		bool first = true;
+		for (const auto & [e, profiler] : em.getEntities<const ProfilerComponent>()) {
+			const auto name = getName(e);
+			for (size_t i = 0; i < profiler.sampleCount(); ++i) {
+				const auto & sample = profiler.samples[i];
+				if (!first)
+					f << ',';
+				first = false;
+				// One row ("thread") per system, timestamps in microseconds
+				f << "{\"name\":";
+				writeJSONString(f, name.c_str());
+				f << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.id
+					<< ",\"ts\":" << sample.start * 1000000.
+					<< ",\"dur\":" << (double)sample.duration * 1000000. << '}';
+			}
+		}
+		f << "]}\n";
+		return true;
+	}
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "string.hpp"
+
+namespace kengine {
+	class EntityManager;
+	class Entity;
+}
+
+namespace kengine::ProfilerHelper {
+	// The system's NameComponent if it has one, "System <id>" otherwise
+	putils::string<64> getName(const Entity & e);
+
+	bool dumpCSV(EntityManager & em, const char * file);
+	bool dumpChromeTrace(EntityManager & em, const char * file);
+}
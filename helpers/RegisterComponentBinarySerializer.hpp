@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "EntityManager.hpp"
+#include "meta/SaveToBinary.hpp"
+#include "meta/LoadFromBinary.hpp"
+#include "helpers/TypeHelper.hpp"
+
+namespace kengine {
+	template<typename Comp>
+	void registerComponentBinarySerializer(EntityManager & em);
+
+	template<typename ... Comps>
+	void registerComponentBinarySerializers(EntityManager & em);
+}
+
+namespace kengine {
+	namespace detail::binary {
+		template<typename T, typename = void>
+		struct is_resizable_sequence : std::false_type {};
+		template<typename T> // std::vector, putils::vector...
+		struct is_resizable_sequence<T, std::void_t<decltype(std::declval<T &>().clear()), decltype(std::declval<T &>().emplace_back()), decltype(std::declval<const T &>().size())>> : std::true_type {};
+
+		template<typename T, typename = void>
+		struct has_full : std::false_type {};
+		template<typename T> // Fixed-capacity containers
+		struct has_full<T, std::void_t<decltype(std::declval<const T &>().full())>> : std::true_type {};
+
+		template<typename T>
+		void write(std::vector<char> & out, const T & value) {
+			static_assert(!std::is_pointer<T>(), "Pointers can't be serialized");
+
+			if constexpr (std::is_trivially_copyable<T>()) {
+				const auto bytes = reinterpret_cast<const char *>(&value);
+				out.insert(out.end(), bytes, bytes + sizeof(T));
+			}
+			else if constexpr (std::is_same<T, std::string>()) {
+				write(out, (uint32_t)value.size());
+				out.insert(out.end(), value.begin(), value.end());
+			}
+			else if constexpr (is_resizable_sequence<T>()) {
+				write(out, (uint32_t)value.size());
+				for (const auto & element : value)
+					write(out, element);
+			}
+			else {
+				static_assert(putils::reflection::has_attributes<T>(), "Type can't be serialized: it is neither trivially copyable, a string, a vector nor reflectible");
+				putils::reflection::for_each_attribute<T>([&](const char * name, const auto member) {
+					write(out, value.*member);
+				});
+			}
+		}
+
+		// Advances `data`, returns false if it ends before `value` does
+		template<typename T>
+		bool read(const char * & data, const char * end, T & value) {
+			if constexpr (std::is_trivially_copyable<T>()) {
+				if (size_t(end - data) < sizeof(T))
+					return false;
+				std::memcpy(&value, data, sizeof(T));
+				data += sizeof(T);
+				return true;
+			}
+			else if constexpr (std::is_same<T, std::string>()) {
+				uint32_t size;
+				if (!read(data, end, size) || size_t(end - data) < size)
+					return false;
+				value.assign(data, size);
+				data += size;
+				return true;
+			}
+			else if constexpr (is_resizable_sequence<T>()) {
+				uint32_t size;
+				if (!read(data, end, size))
+					return false;
+				value.clear();
+				for (uint32_t i = 0; i < size; ++i) {
+					if constexpr (has_full<T>())
+						if (value.full())
+							return false;
+					if (!read(data, end, value.emplace_back()))
+						return false;
+				}
+				return true;
+			}
+			else {
+				bool ok = true;
+				putils::reflection::for_each_attribute<T>([&](const char * name, const auto member) {
+					ok = ok && read(data, end, value.*member);
+				});
+				return ok;
+			}
+		}
+
+		template<typename Comp>
+		static void saveBinaryComponents(EntityManager & em, const size_t * ids, size_t count, std::vector<char> & out) {
+			if constexpr (std::is_empty<Comp>())
+				return; // Entirely described by the Entities' masks
+			else if constexpr (detail::is_shared<Comp>()) // All of the archetype's Entities share the same value
+				write(out, Component<Comp>::read(em._getComponentMap(), ids[0]));
+			else if constexpr (std::is_trivially_copyable<Comp>()) {
+				const auto offset = out.size();
+				out.resize(offset + count * sizeof(Comp));
+				for (size_t i = 0; i < count; ++i)
+					std::memcpy(out.data() + offset + i * sizeof(Comp), &Component<Comp>::read(em._getComponentMap(), ids[i]), sizeof(Comp));
+			}
+			else
+				for (size_t i = 0; i < count; ++i)
+					write(out, Component<Comp>::read(em._getComponentMap(), ids[i]));
+		}
+
+		template<typename Comp>
+		static bool loadBinaryComponents(EntityManager & em, const char * data, size_t size, const size_t * ids, size_t count) {
+			const auto end = data + size;
+
+			if constexpr (std::is_empty<Comp>())
+				return true;
+			else if constexpr (detail::is_shared<Comp>()) {
+				Comp value;
+				if (!read(data, end, value))
+					return false;
+				const auto index = em.addSharedValue(std::move(value));
+				for (size_t i = 0; i < count; ++i)
+					em.getEntity(ids[i]).setShared<Comp>(index);
+				return data == end;
+			}
+			else if constexpr (std::is_trivially_copyable<Comp>()) {
+				if (size != count * sizeof(Comp))
+					return false;
+				// The payload is laid out exactly as in memory, so copy it in runs of contiguous Components (whole chunks or archetype columns)
+				for (size_t i = 0; i < count;) {
+					size_t run;
+					const auto dest = Component<Comp>::getRun(em._getComponentMap(), ids + i, count - i, run);
+					std::memcpy(dest, data + i * sizeof(Comp), run * sizeof(Comp));
+					i += run;
+				}
+				return true;
+			}
+			else {
+				for (size_t i = 0; i < count; ++i) {
+					auto & comp = Component<Comp>::get(em._getComponentMap(), ids[i]);
+					comp = Comp{}; // Members which aren't reflected are reset rather than left to a previous Entity
+					if (!read(data, end, comp))
+						return false;
+				}
+				return data == end;
+			}
+		}
+	}
+
+	template<typename Comp>
+	void registerComponentBinarySerializer(EntityManager & em) {
+		auto type = TypeHelper::getTypeEntity<Comp>(em);
+		type += meta::SaveToBinary{ detail::binary::saveBinaryComponents<Comp> };
+		type += meta::LoadFromBinary{ detail::binary::loadBinaryComponents<Comp> };
+	}
+
+	template<typename ... Comps>
+	void registerComponentBinarySerializers(EntityManager & em) {
+		putils::for_each_type<Comps...>([&](auto type) {
+			using Type = putils_wrapped_type(type);
+			registerComponentBinarySerializer<Type>(em);
+		});
+	}
+}
@@ -0,0 +1,377 @@
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+
+#ifdef _WIN32
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# ifndef NOMINMAX
+#  define NOMINMAX
+# endif
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+#include "SnapshotHelper.hpp"
+#include "EntityManager.hpp"
+#include "meta/SaveToBinary.hpp"
+#include "meta/LoadFromBinary.hpp"
+
+namespace kengine::SnapshotHelper {
+	// A snapshot is a Header followed by `groupCount` groups of Entities, one per archetype. Each group is made of:
+	//	- a GroupHeader
+	//	- the Entities' saved IDs, as uint64_t
+	//	- `typeCount` sections, each made of a TypeHeader, the type's name and the payload written by its meta::SaveToBinary
+	// Each part starts on an 8-byte boundary relative to the start of the snapshot, so that it can be read in place
+	namespace {
+		constexpr char Magic[8] = { 'K', 'E', 'N', 'G', 'S', 'N', 'A', 'P' };
+		constexpr uint32_t ByteOrderMark = 0x01020304;
+
+		struct Header {
+			char magic[8];
+			uint32_t version;
+			uint32_t byteOrderMark; // Snapshots can only be loaded on machines with the same endianness
+			uint64_t groupCount;
+		};
+
+		struct GroupHeader {
+			uint64_t entityCount;
+			uint64_t typeCount;
+		};
+
+		struct TypeHeader {
+			uint64_t nameLength;
+			uint64_t payloadSize;
+		};
+
+		struct Serializer {
+			size_t component;
+			std::string_view name;
+			meta::SaveToBinary save;
+			meta::LoadFromBinary load;
+		};
+
+		std::vector<Serializer> getSerializers(EntityManager & em) {
+			std::vector<Serializer> ret;
+			for (size_t component = 0; component < KENGINE_COMPONENT_COUNT; ++component) {
+				const auto type = detail::registry->byID[component].load(std::memory_order_acquire);
+				if (type == nullptr)
+					break;
+
+				const auto typeEntityID = em.getTypeEntityID(component);
+				if (typeEntityID == Entity::INVALID_ID)
+					continue;
+
+				const auto typeEntity = em.getEntity(typeEntityID);
+				Serializer serializer{ component, type->name };
+				if (typeEntity.has<meta::SaveToBinary>())
+					serializer.save = typeEntity.get<meta::SaveToBinary>();
+				if (typeEntity.has<meta::LoadFromBinary>())
+					serializer.load = typeEntity.get<meta::LoadFromBinary>();
+				if (serializer.save != nullptr || serializer.load != nullptr)
+					ret.push_back(std::move(serializer));
+			}
+			return ret;
+		}
+
+		template<typename T>
+		void append(std::vector<char> & out, const T & value) {
+			const auto bytes = reinterpret_cast<const char *>(&value);
+			out.insert(out.end(), bytes, bytes + sizeof(T));
+		}
+
+		void pad(std::vector<char> & out, size_t begin) {
+			const auto size = out.size() - begin;
+			out.resize(begin + ((size + 7) & ~size_t(7)));
+		}
+
+		// Read-only mapping of a whole file, so that snapshots are loaded straight from the page cache instead of being copied to a buffer first
+		class MappedFile {
+		public:
+			explicit MappedFile(const char * file) {
+#ifdef _WIN32
+				_file = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+				if (_file == INVALID_HANDLE_VALUE)
+					return;
+				LARGE_INTEGER fileSize;
+				if (!GetFileSizeEx(_file, &fileSize) || fileSize.QuadPart == 0)
+					return;
+				_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (_mapping == nullptr)
+					return;
+				data = static_cast<const char *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+				if (data != nullptr)
+					size = (size_t)fileSize.QuadPart;
+#else
+				const auto fd = open(file, O_RDONLY);
+				if (fd < 0)
+					return;
+				struct stat st;
+				if (fstat(fd, &st) == 0 && st.st_size > 0) {
+					const auto mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+					if (mapped != MAP_FAILED) {
+						madvise(mapped, (size_t)st.st_size, MADV_SEQUENTIAL);
+						data = static_cast<const char *>(mapped);
+						size = (size_t)st.st_size;
+					}
+				}
+				close(fd); // The mapping keeps the file alive
+#endif
+			}
+
+			~MappedFile() {
+#ifdef _WIN32
+				if (data != nullptr)
+					UnmapViewOfFile(data);
+				if (_mapping != nullptr)
+					CloseHandle(_mapping);
+				if (_file != INVALID_HANDLE_VALUE)
+					CloseHandle(_file);
+#else
+				if (data != nullptr)
+					munmap(const_cast<char *>(data), size);
+#endif
+			}
+
+			MappedFile(const MappedFile &) = delete;
+			MappedFile & operator=(const MappedFile &) = delete;
+
+			const char * data = nullptr;
+			size_t size = 0;
+
+#ifdef _WIN32
+		private:
+			HANDLE _file = INVALID_HANDLE_VALUE;
+			HANDLE _mapping = nullptr;
+#endif
+		};
+
+		// Bounds-checked cursor over a snapshot
+		struct Reader {
+			const char * begin;
+			const char * current;
+			const char * end;
+
+			const char * take(size_t size) {
+				if (size_t(end - current) < size)
+					return nullptr;
+				const auto ret = current;
+				current += size;
+				return ret;
+			}
+
+			template<typename T>
+			bool read(T & value) {
+				const auto bytes = take(sizeof(T));
+				if (bytes == nullptr)
+					return false;
+				std::memcpy(&value, bytes, sizeof(T));
+				return true;
+			}
+
+			bool skipPadding() {
+				const auto offset = size_t(current - begin);
+				return take(((offset + 7) & ~size_t(7)) - offset) != nullptr;
+			}
+		};
+	}
+
+	void save(EntityManager & em, std::vector<char> & out) {
+		em.makeCurrent();
+
+		std::vector<Serializer> serializers;
+		Entity::Mask serializable;
+		for (auto & serializer : getSerializers(em))
+			if (serializer.save != nullptr) {
+				serializable.set(serializer.component);
+				serializers.push_back(std::move(serializer));
+			}
+
+		// Masks are owned by archetypes, so this groups Entities by archetype and shared Components keep their value within a group
+		std::unordered_map<const Entity::Mask *, size_t> groupIndices;
+		std::vector<std::pair<const Entity::Mask *, std::vector<Entity::ID>>> groups;
+		const Entity::Mask * previousMask = nullptr;
+		size_t group = 0;
+		for (const auto e : em.getEntities()) {
+			if (e.componentMask != previousMask) { // Consecutive Entities often share an archetype
+				previousMask = e.componentMask;
+				if (!e.componentMask->intersects(serializable))
+					group = detail::INVALID;
+				else {
+					const auto [it, inserted] = groupIndices.emplace(e.componentMask, groups.size());
+					if (inserted)
+						groups.emplace_back(e.componentMask, std::vector<Entity::ID>{});
+					group = it->second;
+				}
+			}
+			if (group != detail::INVALID)
+				groups[group].second.push_back(e.id);
+		}
+
+		const auto begin = out.size();
+		Header header;
+		std::memcpy(header.magic, Magic, sizeof(Magic));
+		header.version = Version;
+		header.byteOrderMark = ByteOrderMark;
+		header.groupCount = groups.size();
+		append(out, header);
+
+		for (const auto & [mask, ids] : groups) {
+			GroupHeader groupHeader{ ids.size(), 0 };
+			for (const auto & serializer : serializers)
+				if (mask->test(serializer.component))
+					++groupHeader.typeCount;
+			append(out, groupHeader);
+
+			for (const auto id : ids)
+				append(out, (uint64_t)id);
+
+			for (const auto & serializer : serializers) {
+				if (!mask->test(serializer.component))
+					continue;
+
+				const auto typeHeaderOffset = out.size();
+				append(out, TypeHeader{ serializer.name.size(), 0 });
+				out.insert(out.end(), serializer.name.begin(), serializer.name.end());
+				pad(out, begin);
+
+				const auto payloadOffset = out.size();
+				serializer.save(em, ids.data(), ids.size(), out);
+				const uint64_t payloadSize = out.size() - payloadOffset;
+				std::memcpy(out.data() + typeHeaderOffset + offsetof(TypeHeader, payloadSize), &payloadSize, sizeof(payloadSize));
+				pad(out, begin);
+			}
+		}
+	}
+
+	bool saveToFile(EntityManager & em, const char * file) {
+		std::ofstream f(file, std::ios::binary);
+		if (!f)
+			return false;
+
+		std::vector<char> buffer;
+		save(em, buffer);
+		f.write(buffer.data(), buffer.size());
+		return bool(f);
+	}
+
+	bool load(EntityManager & em, const char * data, size_t size, std::unordered_map<Entity::ID, Entity::ID> * idMap) {
+		em.makeCurrent();
+		Reader reader{ data, data, data + size };
+
+		Header header;
+		if (!reader.read(header) ||
+			std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+			header.version != Version ||
+			header.byteOrderMark != ByteOrderMark)
+			return false;
+
+		std::unordered_map<std::string_view, meta::LoadFromBinary> loaders;
+		std::unordered_map<std::string_view, size_t> components;
+		for (auto & serializer : getSerializers(em))
+			if (serializer.load != nullptr) {
+				components[serializer.name] = serializer.component;
+				loaders[serializer.name] = std::move(serializer.load);
+			}
+
+		struct Section {
+			const meta::LoadFromBinary * load;
+			const char * payload;
+			size_t size;
+		};
+		struct Group {
+			size_t entityCount;
+			const char * savedIDs;
+			Entity::Mask mask;
+			size_t firstSection;
+		};
+		std::vector<Section> sections;
+		std::vector<Group> groups;
+
+		// The whole snapshot is validated before creating anything, so that a malformed one leaves `em` untouched
+		for (uint64_t group = 0; group < header.groupCount; ++group) {
+			GroupHeader groupHeader;
+			if (!reader.read(groupHeader))
+				return false;
+
+			// Checked before multiplying, so that a corrupted count can't overflow into a small size
+			if (groupHeader.entityCount > size_t(reader.end - reader.current) / sizeof(uint64_t))
+				return false;
+			const auto savedIDs = reader.take(groupHeader.entityCount * sizeof(uint64_t));
+			if (savedIDs == nullptr)
+				return false;
+
+			Group parsed{ groupHeader.entityCount, savedIDs, {}, sections.size() };
+			for (uint64_t type = 0; type < groupHeader.typeCount; ++type) {
+				TypeHeader typeHeader;
+				if (!reader.read(typeHeader))
+					return false;
+				const auto name = reader.take(typeHeader.nameLength);
+				if (name == nullptr || !reader.skipPadding())
+					return false;
+				const auto payload = reader.take(typeHeader.payloadSize);
+				if (payload == nullptr || !reader.skipPadding())
+					return false;
+
+				const std::string_view typeName(name, typeHeader.nameLength);
+				const auto it = loaders.find(typeName);
+				if (it == loaders.end()) // Types which no longer exist or aren't registered are skipped
+					continue;
+				parsed.mask.set(components[typeName]);
+				sections.push_back({ &it->second, payload, typeHeader.payloadSize });
+			}
+
+			if (parsed.mask.none()) // None of the group's types are loadable, so its Entities would be empty
+				continue;
+			groups.push_back(parsed);
+		}
+
+		if (reader.current != reader.end)
+			return false;
+
+		// A section's loader may still reject its payload, in which case the groups created before it are removed
+		std::vector<Entity::ID> created;
+		for (size_t group = 0; group < groups.size(); ++group) {
+			const auto & toCreate = groups[group];
+			const auto sectionsEnd = group + 1 < groups.size() ? groups[group + 1].firstSection : sections.size();
+			const auto success = em.createEntities(toCreate.entityCount, toCreate.mask, [&](const std::vector<Entity::ID> & ids) {
+				for (auto section = toCreate.firstSection; section < sectionsEnd; ++section)
+					if (!(*sections[section].load)(em, sections[section].payload, sections[section].size, ids.data(), ids.size()))
+						return false; // The group's Entities are dropped rather than activated half-loaded
+				created.insert(created.end(), ids.begin(), ids.end());
+				return true;
+			});
+
+			if (!success) {
+				for (const auto id : created)
+					em.removeEntity(id);
+				return false;
+			}
+		}
+
+		if (idMap != nullptr) {
+			size_t i = 0;
+			for (const auto & group : groups)
+				for (size_t j = 0; j < group.entityCount; ++j) {
+					uint64_t savedID;
+					std::memcpy(&savedID, group.savedIDs + j * sizeof(uint64_t), sizeof(savedID));
+					(*idMap)[savedID] = created[i++];
+				}
+		}
+
+		return true;
+	}
+
+	bool loadFromFile(EntityManager & em, const char * file, std::unordered_map<Entity::ID, Entity::ID> * idMap) {
+		const MappedFile mapping(file);
+		if (mapping.data == nullptr)
+			return false;
+		return load(em, mapping.data, mapping.size, idMap);
+	}
+}
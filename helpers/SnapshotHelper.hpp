@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Entity.hpp"
+
+namespace kengine { class EntityManager; }
+
+namespace kengine::SnapshotHelper {
+	static constexpr uint32_t Version = 1; // Incremented whenever the format changes
+
+	// Appends the Components of all Entities to `out`, for the types which implement meta::SaveToBinary (see registerComponentBinarySerializer)
+	void save(EntityManager & em, std::vector<char> & out);
+	bool saveToFile(EntityManager & em, const char * file);
+
+	// Creates the Entities described by a snapshot. `idMap`, if given, receives the new ID of each saved Entity, indexed by its saved ID
+	// Returns false if `data` is malformed or was saved by another version
+	bool load(EntityManager & em, const char * data, size_t size, std::unordered_map<Entity::ID, Entity::ID> * idMap = nullptr);
+	bool loadFromFile(EntityManager & em, const char * file, std::unordered_map<Entity::ID, Entity::ID> * idMap = nullptr);
+}
@@ -12,7 +12,7 @@ namespace kengine::TypeHelper {
 namespace kengine::TypeHelper {
     template <typename T>
     Entity getTypeEntity(EntityManager & em) {
-		static Entity::ID ret = Component<T>::typeEntityID([&] { return em.createEntity([](Entity &){}).id; });
+		const auto ret = Component<T>::typeEntityID(em._getComponentMap(), [&] { return em.createEntity([](Entity &){}).id; });
         return em.getEntity(ret);
     }
 }
\ No newline at end of file
@@ -9,7 +9,6 @@
 #include "data/NameComponent.hpp"
 
 #include "functions/OnTerminate.hpp"
-#include "functions/OnEntityCreated.hpp"
 
 #include "imgui.h"
 #include "vector.hpp"
@@ -42,7 +41,7 @@ namespace kengine {
 	using string = AdjustableComponent::string;
 
 	// declarations
-	static void onEntityCreated(Entity & e);
+	static void initAdjustable(AdjustableComponent & comp);
 	static void save(EntityManager & em);
 	static void load(EntityManager & em);
 	//
@@ -57,7 +56,7 @@ namespace kengine {
 		return [&](Entity & e) {
 			load(em);
 			e += functions::OnTerminate{ [&] { save(em); } };
-			e += functions::OnEntityCreated{ onEntityCreated };
+			em.onAttach<AdjustableComponent>([](Entity & e, AdjustableComponent & comp) { initAdjustable(comp); });
 
 			e += NameComponent{ "Adjustables" };
 			auto & tool = e.attach<ImGuiToolComponent>();
@@ -135,18 +134,10 @@ namespace kengine {
 	}
 
 	// declarations
-	static void initAdjustable(AdjustableComponent & comp);
 	using IniSection = std::unordered_map<string, string>;
 	using IniFile = std::unordered_map<string, IniSection>;
 	static IniFile g_loadedFile;
 	//
-	static void onEntityCreated(Entity & e) {
-		if (!e.has<AdjustableComponent>())
-			return;
-
-		initAdjustable(e.get<AdjustableComponent>());
-	}
-
 	static void load(EntityManager & em) {
 		std::ifstream f(KENGINE_ADJUSTABLE_SAVE_FILE);
 		if (!f)
@@ -0,0 +1,85 @@
+#include "ImGuiProfilerSystem.hpp"
+#include "EntityManager.hpp"
+
+#include "data/ImGuiComponent.hpp"
+#include "data/ImGuiToolComponent.hpp"
+#include "data/NameComponent.hpp"
+#include "data/ProfilerComponent.hpp"
+
+#include "helpers/ProfilerHelper.hpp"
+
+#include "imgui.h"
+#include "vector.hpp"
+#include "string.hpp"
+
+#ifndef KENGINE_PROFILER_MAX_SYSTEMS
+# define KENGINE_PROFILER_MAX_SYSTEMS 128
+#endif
+
+#ifndef KENGINE_PROFILER_CSV_FILE
+# define KENGINE_PROFILER_CSV_FILE "profile.csv"
+#endif
+
+#ifndef KENGINE_PROFILER_TRACE_FILE
+# define KENGINE_PROFILER_TRACE_FILE "profile.json"
+#endif
+
+namespace kengine {
+	EntityCreatorFunctor<64> ImGuiProfilerSystem(EntityManager & em) {
+		return [&](Entity & e) {
+			e += NameComponent{ "Profiler" };
+			auto & tool = e.attach<ImGuiToolComponent>();
+			tool.enabled = false;
+
+			e += ImGuiComponent([&] {
+				if (!tool.enabled)
+					return;
+
+				if (ImGui::Begin("Profiler", &tool.enabled)) {
+					ImGui::Columns(2);
+					if (ImGui::Button("Dump CSV"))
+						ProfilerHelper::dumpCSV(em, KENGINE_PROFILER_CSV_FILE);
+					ImGui::NextColumn();
+					if (ImGui::Button("Dump Chrome trace"))
+						ProfilerHelper::dumpChromeTrace(em, KENGINE_PROFILER_TRACE_FILE);
+					ImGui::Columns();
+					ImGui::Separator();
+
+					struct Row {
+						putils::string<64> name;
+						const ProfilerComponent * profiler;
+						float p95;
+					};
+					putils::vector<Row, KENGINE_PROFILER_MAX_SYSTEMS> rows;
+					for (const auto & [e, profiler] : em.getEntities<const ProfilerComponent>()) {
+						if (rows.full())
+							break;
+						rows.push_back({ ProfilerHelper::getName(e), &profiler, profiler.percentile(.95f) });
+					}
+
+					// Most expensive systems first
+					std::sort(rows.begin(), rows.end(), [](const Row & lhs, const Row & rhs) { return lhs.p95 > rhs.p95; });
+
+					ImGui::Columns(6);
+					ImGui::Text("System"); ImGui::NextColumn();
+					ImGui::Text("Calls"); ImGui::NextColumn();
+					ImGui::Text("Last (ms)"); ImGui::NextColumn();
+					ImGui::Text("p50 (ms)"); ImGui::NextColumn();
+					ImGui::Text("p95 (ms)"); ImGui::NextColumn();
+					ImGui::Text("p99 (ms)"); ImGui::NextColumn();
+					ImGui::Separator();
+					for (const auto & row : rows) {
+						ImGui::Text("%s", row.name.c_str()); ImGui::NextColumn();
+						ImGui::Text("%zu", row.profiler->callCount); ImGui::NextColumn();
+						ImGui::Text("%.3f", row.profiler->last().duration * 1000.f); ImGui::NextColumn();
+						ImGui::Text("%.3f", row.profiler->percentile(.5f) * 1000.f); ImGui::NextColumn();
+						ImGui::Text("%.3f", row.p95 * 1000.f); ImGui::NextColumn();
+						ImGui::Text("%.3f", row.profiler->percentile(.99f) * 1000.f); ImGui::NextColumn();
+					}
+					ImGui::Columns();
+				}
+				ImGui::End();
+			});
+		};
+	}
+}
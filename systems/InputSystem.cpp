@@ -5,39 +5,37 @@
 #include "functions/Execute.hpp"
 
 namespace kengine {
-	static InputBufferComponent * g_buffer;
-
 	// declarations
 	static void execute(EntityManager & em);
 	//
 	EntityCreatorFunctor<64> InputSystem(EntityManager & em) {
 		return [&](Entity & e) {
 			e += functions::Execute{ [&](float deltaTime) { execute(em); } };
-			g_buffer = &e.attach<InputBufferComponent>();
 		};
 	}
 
 	static void execute(EntityManager & em) {
+		auto & buffer = em.resource<InputBufferComponent>();
 		for (const auto &[e, comp] : em.getEntities<InputComponent>()) {
-			for (const auto & e : g_buffer->keys)
+			for (const auto & e : buffer.keys)
 				if (comp.onKey != nullptr)
 					comp.onKey(e.window, e.key, e.pressed);
 
 			if (comp.onMouseButton != nullptr)
-				for (const auto & e : g_buffer->clicks)
+				for (const auto & e : buffer.clicks)
 					comp.onMouseButton(e.window, e.button, e.pos, e.pressed);
 
 			if (comp.onMouseMove != nullptr)
-				for (const auto & e : g_buffer->moves)
+				for (const auto & e : buffer.moves)
 					comp.onMouseMove(e.window, e.pos, e.rel);
 
 			if (comp.onScroll != nullptr)
-				for (const auto & e : g_buffer->scrolls)
+				for (const auto & e : buffer.scrolls)
 					comp.onScroll(e.window, e.xoffset, e.yoffset, e.pos);
 		}
-		g_buffer->keys.clear();
-		g_buffer->clicks.clear();
-		g_buffer->moves.clear();
-		g_buffer->scrolls.clear();
+		buffer.keys.clear();
+		buffer.clicks.clear();
+		buffer.moves.clear();
+		buffer.scrolls.clear();
 	}
 }
\ No newline at end of file
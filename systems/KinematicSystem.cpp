@@ -4,6 +4,8 @@
 #include "data/KinematicComponent.hpp"
 #include "data/PhysicsComponent.hpp"
 #include "data/TransformComponent.hpp"
+#include "data/SystemAccessComponent.hpp"
+#include "data/FixedTimestepComponent.hpp"
 
 #include "functions/Execute.hpp"
 
@@ -16,11 +18,15 @@ namespace kengine {
 	EntityCreatorFunctor<64> KinematicSystem(EntityManager & em) {
 		return [&](Entity & e) {
 			e += functions::Execute{ [&](float deltaTime) { execute(em, deltaTime); } };
+			e.attach<SystemAccessComponent>()
+				.read<PhysicsComponent, KinematicComponent>()
+				.write<TransformComponent>();
+			e += FixedTimestepComponent{};
 		};
 	}
 
 	static void execute(EntityManager & em, float deltaTime) {
-		for (const auto & [e, transform, physics, kinematic] : em.getEntities<TransformComponent, PhysicsComponent, KinematicComponent>()) {
+		em.parallelForEach<TransformComponent, const PhysicsComponent, const KinematicComponent>([&](Entity & e, TransformComponent & transform, const PhysicsComponent & physics, const KinematicComponent & kinematic) {
 			transform.boundingBox.position += physics.movement * physics.speed * deltaTime;
 
 			const auto applyRotation = [&](float & transformMember, float physicsMember) {
@@ -31,6 +37,6 @@ namespace kengine {
 			applyRotation(transform.pitch, physics.pitch);
 			applyRotation(transform.yaw, physics.yaw);
 			applyRotation(transform.roll, physics.roll);
-		}
+		});
 	}
 }
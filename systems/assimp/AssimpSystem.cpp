@@ -518,8 +518,8 @@ namespace kengine {
 	}
 
 	static void execute(float deltaTime) {
-		for (auto & [e, graphics, skeleton, anim] : g_em->getEntities<GraphicsComponent, SkeletonComponent, AnimationComponent>())
-			g_em->runTask([&] {
+		g_em->parallelForEach<GraphicsComponent, SkeletonComponent, AnimationComponent>(
+			[&](Entity & e, GraphicsComponent & graphics, SkeletonComponent & skeleton, AnimationComponent & anim) {
 				if (graphics.model == Entity::INVALID_ID)
 					return;
 
@@ -542,9 +542,8 @@ namespace kengine {
 
 				anim.currentTime += deltaTime * anim.speed;
 				anim.currentTime = fmodf(anim.currentTime, currentAnim.totalTime);
-			});
-
-		g_em->completeTasks();
+			}
+		);
 	}
 
 	static void loadModel(Entity & e) {
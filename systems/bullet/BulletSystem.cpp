@@ -19,6 +19,7 @@
 #include "data/PhysicsComponent.hpp"
 #include "data/SkeletonComponent.hpp"
 #include "data/TransformComponent.hpp"
+#include "data/FixedTimestepComponent.hpp"
 
 #include "functions/Execute.hpp"
 #include "functions/OnEntityRemoved.hpp"
@@ -159,6 +160,7 @@ namespace kengine {
 			e += functions::Execute{ execute };
 			e += functions::OnEntityRemoved{ onEntityRemoved };
 			e += functions::QueryPosition{ queryPosition };
+			e += FixedTimestepComponent{};
 
 			e += AdjustableComponent{
 				"Physics", {
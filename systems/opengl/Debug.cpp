@@ -76,7 +76,7 @@ namespace kengine::Shaders {
 		_proj = params.proj;
 		_viewPos = params.camPos;
 
-		for (const auto &[e, debug, transform] : _em.getEntities<DebugGraphicsComponent, TransformComponent>()) {
+		for (const auto &[e, debug, transform] : _em.getEntities<const DebugGraphicsComponent, const TransformComponent>()) {
 			_color = debug.color;
 			_entityID = (float)e.id;
 
@@ -44,7 +44,7 @@ namespace kengine::Shaders {
 		_viewPos = params.camPos;
 		_screenSize = putils::Point2f(params.viewPort.size);
 
-		for (const auto &[e, light, depthMap, comp] : _em.getEntities<DirLightComponent, CSMComponent, GodRaysComponent>()) {
+		for (const auto &[e, light, depthMap, comp] : _em.getEntities<const DirLightComponent, const CSMComponent, const GodRaysComponent>()) {
 			_scattering = comp.scattering;
 			_nbSteps = comp.nbSteps;
 			_defaultStepLength = comp.defaultStepLength;
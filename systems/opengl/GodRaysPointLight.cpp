@@ -45,7 +45,7 @@ namespace kengine::Shaders {
 		assert(src::ShadowCube::Frag::Uniforms::_viewPos.location == src::GodRays::Frag::Uniforms::_viewPos.location);
 		_screenSize = putils::Point2f(params.viewPort.size);
 
-		for (const auto &[e, light, depthMap, transform, comp] : _em.getEntities<PointLightComponent, DepthCubeComponent, TransformComponent, GodRaysComponent>()) {
+		for (const auto &[e, light, depthMap, transform, comp] : _em.getEntities<const PointLightComponent, const DepthCubeComponent, const TransformComponent, const GodRaysComponent>()) {
 			_scattering = comp.scattering;
 			_nbSteps = comp.nbSteps;
 			_defaultStepLength = comp.defaultStepLength;
@@ -86,10 +86,7 @@ namespace kengine {
 	EntityCreator * OpenGLSystem(EntityManager & em) {
 		g_em = &em;
 
-		for (const auto & [e, buffer] : em.getEntities<InputBufferComponent>()) {
-			Input::g_buffer = &buffer;
-			break;
-		}
+		Input::g_buffer = &em.resource<InputBufferComponent>();
 
 		em += [](Entity & e) {
 			e += AdjustableComponent{
@@ -437,7 +434,6 @@ namespace kengine {
 		}
 
 		modelData.free();
-		e.detach<ModelDataComponent>();
 	}
 
 	static void loadTexture(Entity & e, TextureDataComponent & textureData) {
@@ -473,8 +469,6 @@ namespace kengine {
 			if (textureData.free != nullptr)
 				textureData.free(textureData.data);
 		}
-
-		e.detach<TextureDataComponent>();
 	}
 
 	// declarations
@@ -499,16 +493,22 @@ namespace kengine {
 		glfwPollEvents();
 		updateWindowProperties();
 
+		// Structural changes are deferred so as not to disturb iteration
+		auto & commands = g_em->getCommandBuffer();
 		for (auto &[e, modelData] : g_em->getEntities<ModelDataComponent>()) {
 			createObject(e, modelData);
-			if (e.componentMask == 0)
-				g_em->removeEntity(e);
+			if (e.componentMask->count() == 1) // Only had a ModelDataComponent
+				commands.removeEntity(e.id);
+			else
+				commands.detach<ModelDataComponent>(e.id);
 		}
 
 		for (auto &[e, textureLoader] : g_em->getEntities<TextureDataComponent>()) {
 			loadTexture(e, textureLoader);
-			if (e.componentMask == 0)
-				g_em->removeEntity(e);
+			if (e.componentMask->count() == 1) // Only had a TextureDataComponent
+				commands.removeEntity(e.id);
+			else
+				commands.detach<TextureDataComponent>(e.id);
 		}
 
 		doOpenGL();
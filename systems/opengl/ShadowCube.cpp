@@ -21,7 +21,7 @@ namespace kengine::Shaders {
 	}
 
 	void ShadowCube::drawObjects() {
-		for (const auto &[e, graphics, transform, shadow] : _em.getEntities<GraphicsComponent, TransformComponent, DefaultShadowComponent>()) {
+		for (const auto &[e, graphics, transform, shadow] : _em.getEntities<const GraphicsComponent, const TransformComponent, const DefaultShadowComponent>()) {
 			if (graphics.model == Entity::INVALID_ID)
 				continue;
 
@@ -40,7 +40,7 @@ namespace kengine::Shaders {
 
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
 
-		for (const auto & [e, graphics, transform, shadow] : _em.getEntities<GraphicsComponent, TransformComponent, DefaultShadowComponent>()) {
+		for (const auto & [e, graphics, transform, shadow] : _em.getEntities<const GraphicsComponent, const TransformComponent, const DefaultShadowComponent>()) {
 			if (graphics.model == Entity::INVALID_ID)
 				continue;
 
@@ -311,14 +311,14 @@ namespace kengine::Shaders {
 
 		_view = glm::mat4(1.f);
 		_proj = glm::mat4(1.f);
-		for (const auto &[e, text, transform] : _em.getEntities<TextComponent2D, TransformComponent>()) {
+		for (const auto &[e, text, transform] : _em.getEntities<const TextComponent2D, const TransformComponent>()) {
 			_entityID = (float)e.id;
 			drawObject(text, transform, uniforms, glm::vec2(params.viewPort.size.x, params.viewPort.size.y), true);
 		}
 
 		_view = params.view;
 		_proj = params.proj;
-		for (const auto &[e, text, transform] : _em.getEntities<TextComponent3D, TransformComponent>()) {
+		for (const auto &[e, text, transform] : _em.getEntities<const TextComponent3D, const TransformComponent>()) {
 			_entityID = (float)e.id;
 			drawObject(text, transform, uniforms, glm::vec2(params.viewPort.size.x, params.viewPort.size.y));
 		}
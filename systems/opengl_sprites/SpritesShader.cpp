@@ -156,14 +156,14 @@ namespace kengine {
 
 		_view = glm::mat4(1.f);
 		_proj = glm::mat4(1.f);
-		for (const auto &[e, graphics, transform, sprite] : _em.getEntities<GraphicsComponent, TransformComponent, SpriteComponent2D>()) {
+		for (const auto &[e, graphics, transform, sprite] : _em.getEntities<const GraphicsComponent, const TransformComponent, const SpriteComponent2D>()) {
 			_entityID = (float)e.id;
 			drawObject(_em, graphics, transform, uniforms, true);
 		}
 
 		_view = params.view;
 		_proj = params.proj;
-		for (const auto &[e, graphics, transform, sprite] : _em.getEntities<GraphicsComponent, TransformComponent, SpriteComponent3D>()) {
+		for (const auto &[e, graphics, transform, sprite] : _em.getEntities<const GraphicsComponent, const TransformComponent, const SpriteComponent3D>()) {
 			_entityID = (float)e.id;
 			drawObject(_em, graphics, transform, uniforms);
 		}
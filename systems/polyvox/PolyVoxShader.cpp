@@ -87,7 +87,7 @@ namespace kengine {
 		_proj = params.proj;
 		_viewPos = params.camPos;
 
-		for (const auto &[e, poly, graphics, transform] : _em.getEntities<PolyVoxObjectComponent, GraphicsComponent, TransformComponent>()) {
+		for (const auto &[e, poly, graphics, transform] : _em.getEntities<const PolyVoxObjectComponent, const GraphicsComponent, const TransformComponent>()) {
 			if (graphics.model == Entity::INVALID_ID)
 				continue;
 
@@ -0,0 +1,80 @@
+#include <cstdio>
+
+#include "EntityManager.hpp"
+
+// Components must be stored in the EntityManager an Entity belongs to, whichever EntityManager is current on the calling thread
+
+namespace {
+	struct Pos {
+		int x = 0;
+		putils_reflection_class_name(Pos);
+	};
+
+	struct Column {
+		int x = 0;
+		putils_reflection_class_name(Column);
+	};
+
+	struct Sparse {
+		int x = 0;
+		putils_reflection_class_name(Sparse);
+	};
+
+	int failures = 0;
+
+	void check(bool condition, const char * description) {
+		if (!condition) {
+			std::printf("FAILED: %s\n", description);
+			++failures;
+		}
+	}
+
+	template<typename T>
+	int sum(kengine::EntityManager & em) {
+		int ret = 0;
+		for (const auto & [e, comp] : em.getEntities<const T>())
+			ret += comp.x;
+		return ret;
+	}
+
+	template<typename T>
+	void testType(kengine::EntityManager & a, kengine::EntityManager & b) {
+		// `b` was constructed last, so it is current
+		auto e = a.createEntity([](kengine::Entity & e) { e += T{ 42 }; });
+		check(e.template get<T>().x == 42, "Entity::get reads its own EntityManager");
+		check(sum<T>(a) == 42, "attached Component is visible to its EntityManager");
+		check(sum<T>(b) == 0, "attached Component isn't visible to the current EntityManager");
+
+		a.createEntities<T>(2, [](kengine::Entity & e, T & comp) { comp.x = 1; });
+		check(sum<T>(a) == 44, "createEntities initializes its own EntityManager's Components");
+		check(sum<T>(b) == 0, "createEntities doesn't touch the current EntityManager");
+
+		a.getCommandBuffer().attach(a.createEntity([](kengine::Entity &) {}).id, T{ 100 });
+		a.playbackCommands();
+		check(sum<T>(a) == 144, "CommandBuffer attachments go to the playing EntityManager");
+		check(sum<T>(b) == 0, "CommandBuffer attachments don't touch the current EntityManager");
+	}
+}
+
+template<>
+struct kengine::component_storage<Column> {
+	static constexpr auto value = kengine::ComponentStorage::ArchetypeColumns;
+};
+
+template<>
+struct kengine::component_storage<Sparse> {
+	static constexpr auto value = kengine::ComponentStorage::SparseSet;
+};
+
+int main() {
+	kengine::EntityManager a;
+	kengine::EntityManager b;
+
+	testType<Pos>(a, b);
+	testType<Column>(a, b);
+	testType<Sparse>(a, b);
+
+	if (failures == 0)
+		std::printf("OK\n");
+	return failures == 0 ? 0 : 1;
+}